@@ -0,0 +1,317 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef Bitboard_hpp
+#define Bitboard_hpp
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// one bit per square, bit 0 is a1, bit 7 is h1, bit 63 is h8
+typedef uint64_t Bitboard;
+
+constexpr int squareOf(int r, int c) { return (r << 3) | c; }
+constexpr int rowOf(int sq) { return sq >> 3; }
+constexpr int colOf(int sq) { return sq & 7; }
+
+constexpr Bitboard squareBB(int sq) { return 1ULL << sq; }
+
+const Bitboard FileA = 0x0101010101010101ULL;
+const Bitboard FileH = 0x8080808080808080ULL;
+const Bitboard Rank1 = 0x00000000000000FFULL;
+const Bitboard Rank3 = 0x0000000000FF0000ULL;
+const Bitboard Rank6 = 0x0000FF0000000000ULL;
+const Bitboard Rank8 = 0xFF00000000000000ULL;
+
+// every piece moved by offset squares, offsets of 8 are a rank up, the
+// caller masks off pieces that would wrap around the a or h file
+template <int Offset>
+constexpr Bitboard shift(Bitboard b) { return (Offset > 0) ? (b << Offset) : (b >> -Offset); }
+
+// one past the last square, for "no square"
+const int NoSquare = 64;
+
+inline int popCount(Bitboard b) { return __builtin_popcountll(b); }
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+inline int msb(Bitboard b) { return 63 ^ __builtin_clzll(b); }
+
+inline int popLsb(Bitboard& b)
+{
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ray directions, the first four walk towards higher squares
+enum Direction { DirN, DirNE, DirE, DirNW, DirS, DirSW, DirW, DirSE, DirMax };
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// knight, king and pawn attacks are worked out by the compiler
+constexpr Bitboard leap(int sq, int dr, int dc)
+{
+    return ((rowOf(sq) + dr >= 0) && (rowOf(sq) + dr < 8) && (colOf(sq) + dc >= 0) && (colOf(sq) + dc < 8))
+         ? squareBB(squareOf(rowOf(sq) + dr, colOf(sq) + dc)) : 0;
+}
+
+constexpr Bitboard knightMask(int sq)
+{
+    return leap(sq, 2, 1) | leap(sq, 2, -1) | leap(sq, 1, 2) | leap(sq, 1, -2)
+         | leap(sq, -1, 2) | leap(sq, -1, -2) | leap(sq, -2, 1) | leap(sq, -2, -1);
+}
+
+constexpr Bitboard kingMask(int sq)
+{
+    return leap(sq, 1, -1) | leap(sq, 1, 0) | leap(sq, 1, 1) | leap(sq, 0, -1)
+         | leap(sq, 0, 1) | leap(sq, -1, -1) | leap(sq, -1, 0) | leap(sq, -1, 1);
+}
+
+// color 0 is white and captures up the board, 1 is black
+constexpr Bitboard pawnMask(int color, int sq)
+{
+    return (color == 0) ? (leap(sq, 1, -1) | leap(sq, 1, 1)) : (leap(sq, -1, -1) | leap(sq, -1, 1));
+}
+
+// 0, 1, ... N - 1 as a parameter pack
+template <int... I> struct Indices {};
+template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+template <typename> struct StepTables;
+
+template <int... I>
+struct StepTables<Indices<I...> >
+{
+    static constexpr Bitboard knight[64] = { knightMask(I)... };
+    static constexpr Bitboard king[64] = { kingMask(I)... };
+    static constexpr Bitboard pawn[2][64] = { { pawnMask(0, I)... }, { pawnMask(1, I)... } };
+};
+
+template <int... I> constexpr Bitboard StepTables<Indices<I...> >::knight[64];
+template <int... I> constexpr Bitboard StepTables<Indices<I...> >::king[64];
+template <int... I> constexpr Bitboard StepTables<Indices<I...> >::pawn[2][64];
+
+typedef StepTables<MakeIndices<64>::type> Steps;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ray tables, built once on first use and read only afterwards
+class AttackTables
+{
+public:
+    static const AttackTables& get()
+    {
+        static const AttackTables tables;
+        return tables;
+    }
+
+    Bitboard rays[DirMax][64];
+    // squares strictly between two squares on a common rank, file or diagonal
+    Bitboard between[64][64];
+    // the whole rank, file or diagonal through two squares
+    Bitboard line[64][64];
+
+private:
+    AttackTables()
+    {
+        static const int rayDr[DirMax] = { 1, 1, 0, 1, -1, -1, 0, -1 };
+        static const int rayDc[DirMax] = { 0, 1, 1, -1, 0, -1, -1, 1 };
+        for (int sq = 0; sq < 64; ++sq) {
+            int r = rowOf(sq);
+            int c = colOf(sq);
+            for (int d = 0; d < DirMax; ++d) {
+                rays[d][sq] = 0;
+                for (int rT = r + rayDr[d], cT = c + rayDc[d]; onBoard(rT, cT); rT += rayDr[d], cT += rayDc[d]) {
+                    rays[d][sq] |= squareBB(squareOf(rT, cT));
+                }
+            }
+        }
+        for (int sq = 0; sq < 64; ++sq) {
+            for (int to = 0; to < 64; ++to) {
+                between[sq][to] = 0;
+                line[sq][to] = 0;
+            }
+            for (int d = 0; d < DirMax; ++d) {
+                // the ray opposite to d
+                const int o = (d + 4) % DirMax;
+                Bitboard ray = rays[d][sq];
+                while (ray) {
+                    const int to = popLsb(ray);
+                    between[sq][to] = rays[d][sq] & ~rays[d][to] & ~squareBB(to);
+                    line[sq][to] = rays[d][sq] | rays[o][sq] | squareBB(sq);
+                }
+            }
+        }
+    }
+
+    static bool onBoard(int r, int c) { return (r >= 0) && (r < 8) && (c >= 0) && (c < 8); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+inline Bitboard knightAttacks(int sq) { return Steps::knight[sq]; }
+inline Bitboard kingAttacks(int sq) { return Steps::king[sq]; }
+inline Bitboard pawnAttacks(int color, int sq) { return Steps::pawn[color][sq]; }
+inline Bitboard between(int from, int to) { return AttackTables::get().between[from][to]; }
+inline Bitboard line(int from, int to) { return AttackTables::get().line[from][to]; }
+
+// squares reached from sq in direction dir, up to and including the first blocker
+inline Bitboard rayAttacks(int dir, int sq, Bitboard occ)
+{
+    const Bitboard *rays = AttackTables::get().rays[dir];
+    Bitboard attacks = rays[sq];
+    Bitboard blockers = attacks & occ;
+    if (blockers) {
+        int blocker = (dir < DirS) ? lsb(blockers) : msb(blockers);
+        attacks ^= rays[blocker];
+    }
+    return attacks;
+}
+
+inline Bitboard slowRookAttacks(int sq, Bitboard occ)
+{
+    return rayAttacks(DirN, sq, occ) | rayAttacks(DirE, sq, occ)
+         | rayAttacks(DirS, sq, occ) | rayAttacks(DirW, sq, occ);
+}
+
+inline Bitboard slowBishopAttacks(int sq, Bitboard occ)
+{
+    return rayAttacks(DirNE, sq, occ) | rayAttacks(DirNW, sq, occ)
+         | rayAttacks(DirSE, sq, occ) | rayAttacks(DirSW, sq, occ);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// with BMI2 the slider index is a PEXT of the occupancy, build with
+// -mbmi2 (or -march=native) to use it and -DCHESS_NO_PEXT to turn it off
+#if defined(__BMI2__) && !defined(CHESS_NO_PEXT)
+#define CHESS_USE_PEXT 1
+#include <immintrin.h>
+#endif
+
+const Bitboard RookMagics[64] = {
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+const Bitboard BishopMagics[64] = {
+    0xA010041108003100ULL, 0x006082020A002900ULL, 0x6810010619200000ULL, 0x08281A0520000408ULL,
+    0x0001104001000400ULL, 0x0018901008048400ULL, 0x00040A0210245280ULL, 0x000200210808A402ULL,
+    0x9140048410821200ULL, 0x0800091010820041ULL, 0x20504804832202C0ULL, 0x0100091401081000ULL,
+    0x8021011140000012ULL, 0x0810020804450400ULL, 0x208B0542109008A2ULL, 0x0080084A08040204ULL,
+    0x0040E2A80811244CULL, 0x2505022008008108ULL, 0x0430220100420040ULL, 0x010A040420220040ULL,
+    0x1105000290400000ULL, 0x0093001200822120ULL, 0x4000A62048043004ULL, 0x280120048A015004ULL,
+    0x006090002A020814ULL, 0x44042000240800D0ULL, 0x01102800040A4400ULL, 0x1004080080220040ULL,
+    0x0001001011004024ULL, 0x0010044000805040ULL, 0x0914041200820100ULL, 0x0004821012821480ULL,
+    0x0024040500C05021ULL, 0x0088611002080200ULL, 0x0116080A00040020ULL, 0x4000020080080080ULL,
+    0x2450450140840040ULL, 0x0000880201484100ULL, 0x0222020404020092ULL, 0x8081110600002E00ULL,
+    0x2842101105000801ULL, 0x1100809008001025ULL, 0x00020202221C0400ULL, 0x0422014022009020ULL,
+    0x0210046102100C00ULL, 0xC004008082029102ULL, 0x00AA461801101200ULL, 0x0404080080201108ULL,
+    0x020542108C205002ULL, 0x0410544804100100ULL, 0x0040910841100000ULL, 0x0400200042021100ULL,
+    0x00004204850400C0ULL, 0x0200100410A42102ULL, 0x1040020801210102ULL, 0x0805040410420000ULL,
+    0x2884804130100200ULL, 0x800C262201242000ULL, 0x1058000194108800ULL, 0x0014221054420204ULL,
+    0x0104000012A02200ULL, 0x0200881003300100ULL, 0x0140400202840100ULL, 0x0402020801010201ULL
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// the relevant blockers of a slider on one square and where its attacks live
+struct Magic
+{
+    Bitboard mask;
+    Bitboard magic;
+    const Bitboard *attacks;
+    unsigned shift;
+
+    unsigned index(Bitboard occ) const
+    {
+#ifdef CHESS_USE_PEXT
+        return (unsigned)_pext_u64(occ, mask);
+#else
+        return (unsigned)(((occ & mask) * magic) >> shift);
+#endif
+    }
+
+    Bitboard operator()(Bitboard occ) const { return attacks[index(occ)]; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// rook and bishop attacks for every blocker subset, built once on first use
+// and shared read only by every Board in every thread
+class SliderTables
+{
+public:
+    static const SliderTables& get()
+    {
+        static const SliderTables tables;
+        return tables;
+    }
+
+    Magic rook[64];
+    Magic bishop[64];
+
+private:
+    // sum of 2^bits over the rook and the bishop masks of all squares
+    enum { RookTableSize = 102400, BishopTableSize = 5248 };
+
+    SliderTables()
+    {
+        Bitboard *next = table;
+        next = build(rook, RookMagics, slowRookAttacks, next);
+        next = build(bishop, BishopMagics, slowBishopAttacks, next);
+    }
+
+    static Bitboard *build(Magic *magics, const Bitboard *numbers, Bitboard (*slow)(int, Bitboard), Bitboard *next)
+    {
+        for (int sq = 0; sq < 64; ++sq) {
+            // the board edge never blocks a ray so it is not part of the mask
+            const Bitboard edges = ((Rank1 | Rank8) & ~rankOf(sq)) | ((FileA | FileH) & ~fileOf(sq));
+            Magic& m = magics[sq];
+            m.mask = slow(sq, 0) & ~edges;
+            m.magic = numbers[sq];
+            m.shift = 64 - popCount(m.mask);
+            m.attacks = next;
+            // walk every subset of the mask with the carry rippler
+            Bitboard occ = 0;
+            do {
+                next[m.index(occ)] = slow(sq, occ);
+                occ = (occ - m.mask) & m.mask;
+            } while (occ);
+            next += 1ULL << popCount(m.mask);
+        }
+        return next;
+    }
+
+    static Bitboard rankOf(int sq) { return Rank1 << (rowOf(sq) * 8); }
+    static Bitboard fileOf(int sq) { return FileA << colOf(sq); }
+
+    Bitboard table[RookTableSize + BishopTableSize];
+};
+
+inline Bitboard rookAttacks(int sq, Bitboard occ) { return SliderTables::get().rook[sq](occ); }
+inline Bitboard bishopAttacks(int sq, Bitboard occ) { return SliderTables::get().bishop[sq](occ); }
+
+inline Bitboard queenAttacks(int sq, Bitboard occ)
+{
+    const SliderTables& tables = SliderTables::get();
+    return tables.rook[sq](occ) | tables.bishop[sq](occ);
+}
+
+#endif
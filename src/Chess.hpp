@@ -4,10 +4,13 @@
 #ifndef Chess_hpp
 #define Chess_hpp
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <list>
-#include <map>
-#include <set>
+#include <type_traits>
+#include "Bitboard.hpp"
+#include "Random.hpp"
+#include "PieceSquare.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -20,6 +23,8 @@ enum Piece { Empty, Pawn, Rook, Knight, Bishop, Queen, King };
 enum Row { r1, r2, r3, r4, r5, r6, r7, r8, rMax };
 enum Col { ca, cb, cc, cd, ce, cf, cg, ch, cMax };
 enum CastleType { NoCastle, KingSide, QueenSide };
+enum Result { InPlay, WhiteWin, BlackWin, Draw };
+enum DrawReason { NoDraw, Stalemate, FiftyMoves, Repetition, InsufficientMaterial };
 
 typedef Side Turn;
 
@@ -39,6 +44,17 @@ public:
     {
     }
 
+    Square(Color _color, Row _row, Col _col, Piece _piece, Side _side, int _attackWhite, int _attackBlack)
+        : color(_color)
+        , row(_row)
+        , col(_col)
+        , piece(_piece)
+        , side(_side)
+        , attackWhite(_attackWhite)
+        , attackBlack(_attackBlack)
+    {
+    }
+
     void setSquare(Color _color, Row _row, Col _col)
     {
         color = _color;
@@ -169,105 +185,196 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 //
+// a move packed in 16 bits
+//   bits  0..5  from square
+//   bits  6..11 to square
+//   bits 12..13 promotion piece, Rook, Knight, Bishop or Queen
+//   bits 14..15 Normal, Promotion, Enpassant or Castling
+// a castle is the king move, the rook move is implied
 class Move
 {
 public:
-    Move(const Piece _piece = Empty,
-         const Side _side = None,
-         const Row _rF = r1, const Col _cF = ca,
-         const Row _rT = r1, const Col _cT = ca,
-         const bool _enpassant = false,
-         const CastleType _castle = NoCastle)
-        : piece(_piece)
-        , side(_side)
-        , rF(_rF)
-        , cF(_cF)
-        , rT(_rT)
-        , cT(_cT)
-        , enpassant(_enpassant)
-        , castle(_castle)
+    enum Type { Normal = 0, Promotion = 1 << 14, Enpassant = 2 << 14, Castling = 3 << 14 };
+
+    Move() = default;
+
+    Move(int from, int to, Type type = Normal, Piece promotion = Rook)
+        : data((uint16_t)(from | (to << 6) | ((promotion - Rook) << 12) | type))
     {
     }
 
-    Piece getPiece() const { return piece; }
-    Side getSide() const { return side; }
+    Move(Row rF, Col cF, Row rT, Col cT, Type type = Normal, Piece promotion = Rook)
+        : data((uint16_t)(squareOf(rF, cF) | (squareOf(rT, cT) << 6) | ((promotion - Rook) << 12) | type))
+    {
+    }
 
-    bool isKing() const { return piece == King; }
+    // the packed 16 bits, for tables that store moves, 0 (a1 to a1) is no move
+    uint16_t raw() const { return data; }
+    static Move fromRaw(uint16_t raw) { Move move; move.data = raw; return move; }
 
-    bool isWhite() const { return side == White; }
-    bool isBlack() const { return side == Black; }
-    bool isEnpassant() const { return enpassant; }
-    bool isCastle() const { return castle != NoCastle; }
-    bool isKingSide() const { return castle == KingSide; }
-    bool isQueueSide() const { return castle == QueenSide; }
+    int from() const { return data & 0x3F; }
+    int to() const { return (data >> 6) & 0x3F; }
+    Type getType() const { return (Type)(data & (3 << 14)); }
+
+    bool isEnpassant() const { return getType() == Enpassant; }
+    bool isCastle() const { return getType() == Castling; }
+    bool isKingSide() const { return isCastle() && (colT() == cg); }
+    bool isQueueSide() const { return isCastle() && (colT() == cc); }
+    bool isPromotion() const { return getType() == Promotion; }
+
+    // the piece a pawn becomes, Empty if this is not a promotion
+    Piece getPromotion() const { return isPromotion() ? (Piece)(Rook + ((data >> 12) & 3)) : Empty; }
 
     // get the from position of this move
-    void getFrom(Row& _rF, Col& _cF) const { _rF = rF; _cF = cF; }
+    void getFrom(Row& _rF, Col& _cF) const { _rF = rowF(); _cF = colF(); }
     // get the to position of this move
-    void getTo(Row& _rT, Col& _cT) const { _rT = rT; _cT = cT; }
+    void getTo(Row& _rT, Col& _cT) const { _rT = rowT(); _cT = colT(); }
     // get the en passant relative to this move
-    void getEnpassantPosition(Row& _rP, Col& _cP) const { _rP = rF; _cP = cT; }
+    void getEnpassantPosition(Row& _rP, Col& _cP) const { _rP = rowF(); _cP = colT(); }
  
-    bool operator==(const Move& rhs) const { return compare(rhs) == 0; }
-    bool operator!=(const Move& rhs) const { return compare(rhs) != 0; }
-    bool operator>(const Move& rhs) const { return compare(rhs) > 0; }
-    bool operator>=(const Move& rhs) const { return compare(rhs) >= 0; }
-    bool operator<(const Move& rhs) const { return compare(rhs) < 0; }
-    bool operator<=(const Move& rhs) const { return compare(rhs) <= 0; }
+    bool operator==(const Move& rhs) const { return data == rhs.data; }
+    bool operator!=(const Move& rhs) const { return data != rhs.data; }
+    bool operator>(const Move& rhs) const { return data > rhs.data; }
+    bool operator>=(const Move& rhs) const { return data >= rhs.data; }
+    bool operator<(const Move& rhs) const { return data < rhs.data; }
+    bool operator<=(const Move& rhs) const { return data <= rhs.data; }
+
+    Row rowF() const { return (Row)rowOf(from()); }
+    Row rowT() const { return (Row)rowOf(to()); }
+    Col colF() const { return (Col)colOf(from()); }
+    Col colT() const { return (Col)colOf(to()); }
 
-    bool wasFirstPawnDoubleMove() const { return ((piece == Pawn) && ((rF > rT) ? (rF - rT == 2) : (rT - rF) == 2)); }
+    void toStringMove(std::string& str) const
+    {
+        str += Square::toString(colF());
+        str += Square::toString(rowF());
+        str += "->";
+        str += Square::toString(colT());
+        str += Square::toString(rowT());
+        switch (getPromotion())
+        {
+        case Rook: str += "=R"; break;
+        case Knight: str += "=N"; break;
+        case Bishop: str += "=B"; break;
+        case Queen: str += "=Q"; break;
+        default: break;
+        }
+    }
 
-    Row rowF() const { return rF; }
-    Row rowT() const { return rT; }
-    Col colF() const { return cF; }
-    Col colT() const { return cT; }
+private:
+    uint16_t data;
+};
 
-    void toStringPiece(std::string& str) const
+////////////////////////////////////////////////////////////////////////////////
+//
+// a move with the piece that makes it and the piece it takes, see Board::moveInfo
+class MoveInfo
+{
+public:
+    MoveInfo(const Move& _move = Move(0, 0),
+             const Piece _piece = Empty,
+             const Side _side = None,
+             const Piece _captured = Empty)
+        : move(_move)
+        , piece(_piece)
+        , side(_side)
+        , captured(_captured)
     {
-        str += Square::toString(piece, side);
-        str += Square::toString(cF);
-        str += Square::toString(rF);
     }
 
-    void toStringMove(std::string& str) const
+    const Move& getMove() const { return move; }
+
+    Piece getPiece() const { return piece; }
+    Side getSide() const { return side; }
+    Piece getCaptured() const { return captured; }
+
+    bool isKing() const { return piece == King; }
+    bool isCapture() const { return captured != Empty; }
+
+    bool isWhite() const { return side == White; }
+    bool isBlack() const { return side == Black; }
+
+    bool wasFirstPawnDoubleMove() const
     {
-        str += Square::toString(piece, side);
-        str += Square::toString(cF);
-        str += Square::toString(rF);
-        str += "->";
-        str += Square::toString(cT);
-        str += Square::toString(rT);
+        return (piece == Pawn) && ((move.to() - move.from() == 16) || (move.from() - move.to() == 16));
     }
 
-private:
-    int compare(const Move& rhs) const {
-        if (rF < rhs.rF) { return -1; } else if (rF > rhs.rF) { return 1; }
-        if (cF < rhs.cF) { return -1; } else if (cF > rhs.cF) { return 1; }
-        if (rT < rhs.rT) { return -1; } else if (rT > rhs.rT) { return 1; }
-        if (cT < rhs.cT) { return -1; } else if (cT > rhs.cT) { return 1; }
-        return 0;
+    void toStringMove(std::string& str) const
+    {
+        str += Square::toString(piece, side);
+        move.toStringMove(str);
     }
 
 private:
+    Move move;
     Piece piece;
     Side side;
-    Row rF;
-    Col cF;
-    Row rT;
-    Col cT;
-    bool enpassant;
-    CastleType castle;
+    Piece captured;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-typedef std::set<Move> Moves;
+// fixed capacity list, kept on the stack so generating moves never allocates
+template <typename T, unsigned Capacity>
+class FixedList
+{
+public:
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    FixedList() : count(0) {}
+
+    void insert(const T& item)
+    {
+        if (count < Capacity) { items[count++] = item; }
+    }
+
+    // remove the item at idx, the last item takes its place
+    void erase(unsigned idx) { items[idx] = items[--count]; }
+
+    void clear() { count = 0; }
+
+    bool contains(const T& item) const
+    {
+        for (unsigned i = 0; i < count; ++i) {
+            if (items[i] == item) { return true; }
+        }
+        return false;
+    }
+
+    bool empty() const { return count == 0; }
+    unsigned size() const { return count; }
+
+    const T& operator[](unsigned idx) const { return items[idx]; }
+
+    iterator begin() { return items; }
+    iterator end() { return items + count; }
+    const_iterator begin() const { return items; }
+    const_iterator end() const { return items + count; }
+
+private:
+    T items[Capacity];
+    unsigned count;
+};
+
+// no legal chess position has more than 218 moves
+const unsigned MaxMoves = 256;
+// a side never loses more than its 15 pieces other than the king
+const unsigned MaxPieces = 16;
+
+// midgame material in centipawns indexed by Piece, the king is never traded
+constexpr int PieceValues[King + 1] = { 0, MidgameMaterial[Pawn - Pawn], MidgameMaterial[Rook - Pawn],
+                                        MidgameMaterial[Knight - Pawn], MidgameMaterial[Bishop - Pawn],
+                                        MidgameMaterial[Queen - Pawn], MidgameMaterial[King - Pawn] };
+
+typedef FixedList<Move, MaxMoves> Moves;
 typedef Moves::iterator MovesItr;
 typedef Moves::const_iterator MovesCItr;
 
-typedef Moves Pieces;
-typedef MovesItr PiecesItr;
-typedef MovesCItr PiecesCItr;
+// captured pieces and the square they were taken on
+typedef FixedList<Square, MaxPieces> Pieces;
+typedef Pieces::iterator PiecesItr;
+typedef Pieces::const_iterator PiecesCItr;
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -286,6 +393,16 @@ public:
     bool kingSide() const { return (king && rookK); }
     bool queenSide() const { return (king && rookQ); }
 
+    // 1 for king side, 2 for queen side
+    unsigned rights() const { return (kingSide() ? 1 : 0) | (queenSide() ? 2 : 0); }
+
+    void set(bool kingSide, bool queenSide)
+    {
+        king = (kingSide || queenSide);
+        rookK = kingSide;
+        rookQ = queenSide;
+    }
+
     void checkMove(Row r, Col c, Piece piece, Side s)
     {
         if (side != s) { return; }
@@ -318,29 +435,198 @@ private:
     bool king;
 };
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// random keys to hash a position, built once on first use and read only afterwards
+class Zobrist
+{
+public:
+    static const Zobrist& get()
+    {
+        static const Zobrist keys;
+        return keys;
+    }
+
+    // [side][piece - Pawn][square]
+    uint64_t pieces[2][6][64];
+    // white rights | (black rights << 2)
+    uint64_t castle[16];
+    // file of the en passant square
+    uint64_t enpassant[8];
+    // black to move
+    uint64_t turn;
+
+private:
+    Zobrist()
+    {
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for (int s = 0; s < 2; ++s) {
+            for (int p = 0; p < 6; ++p) {
+                for (int sq = 0; sq < 64; ++sq) {
+                    pieces[s][p][sq] = next(state);
+                }
+            }
+        }
+        for (int i = 0; i < 16; ++i) {
+            castle[i] = next(state);
+        }
+        for (int i = 0; i < 8; ++i) {
+            enpassant[i] = next(state);
+        }
+        turn = next(state);
+    }
+
+    // splitmix64
+    static uint64_t next(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// a position in 120 bytes with no pointers, it can be copied with memcpy,
+// Board::toSnapshot and Board::fromSnapshot move a position in and out
+struct Snapshot
+{
+    // [side][piece - Pawn], white is side 0
+    Bitboard pieces[2][6];
+    uint64_t key;
+    // the running scores, so a restore does not add them up again
+    int16_t midgame;
+    int16_t endgame;
+    uint8_t phase;
+    // the side to move is in check
+    uint8_t check;
+    uint16_t fullmoveNumber;
+    uint8_t halfmoveClock;
+    uint8_t turn;
+    // castling rights, white in bits 0 and 1, black in bits 2 and 3
+    uint8_t castle;
+    uint8_t epSquare;
+};
+
+static_assert(sizeof(Snapshot) <= 128, "a snapshot fits in two cache lines");
+static_assert(std::is_trivially_copyable<Snapshot>::value, "a snapshot can be copied with memcpy");
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// what Board::makeMove changed, so Board::unmakeMove can put it back
+struct UndoInfo
+{
+    UndoInfo()
+        : moved(Empty)
+        , captured(Empty)
+        , white(White)
+        , black(Black)
+        , epSquare(NoSquare)
+        , halfmoveClock(0)
+        , key(0)
+        , whiteCheck(false)
+        , blackCheck(false)
+        , promotion(false)
+        , castle(false)
+        , enpassant(false)
+    {
+    }
+
+    // the piece that moved, a Pawn for a promotion
+    Piece moved;
+    // the piece taken by the move, Empty if none
+    Piece captured;
+    // the state of the board before the move
+    Castle white;
+    Castle black;
+    int epSquare;
+    int halfmoveClock;
+    uint64_t key;
+    bool whiteCheck;
+    bool blackCheck;
+    bool promotion;
+    bool castle;
+    bool enpassant;
+};
+
+class Board;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// a move policy picks the move Board::move and Board::playout play, it is a
+// type with const Move *operator()(Board&, const Moves&, Random&) called
+// with at least one legal move, the board may be used to look at the moves
+// but has to be left as it was, policies are template arguments so the
+// call is inlined into the loop, see Policy.hpp for more of them
+//
+// the default policy, every legal move with the same chance
+struct RandomPolicy
+{
+    const Move *operator()(Board&, const Moves& moves, Random& random) const
+    {
+        return &moves[random.below(moves.size())];
+    }
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 class Board
 {
 public:
     Board(unsigned _seed = 0, Turn _turn = White, bool pieces = false)
-        : EN_PASSANT(true)
-        , seed(_seed)
+        : rng(_seed)
         , turn(_turn)
         , white(White)
         , black(Black)
-        , checkAttacker(NULL)
+        , epSquare(NoSquare)
+        , halfmoveClock(0)
+        , fullmoveNumber(1)
+        , key(0)
+        , midgame(0)
+        , endgame(0)
+        , phase(0)
         , whiteCheck(false)
         , blackCheck(false)
         , promotion(false)
         , castle(false)
         , enpassant(false)
+        , drawReason(NoDraw)
+        , plies(0)
     {
         init(pieces);
     }
 
+    explicit Board(const Snapshot& snapshot, unsigned _seed = 0)
+        : rng(_seed)
+        , turn(White)
+        , white(White)
+        , black(Black)
+        , epSquare(NoSquare)
+        , halfmoveClock(0)
+        , fullmoveNumber(1)
+        , key(0)
+        , midgame(0)
+        , endgame(0)
+        , phase(0)
+        , whiteCheck(false)
+        , blackCheck(false)
+        , promotion(false)
+        , castle(false)
+        , enpassant(false)
+        , drawReason(NoDraw)
+        , plies(0)
+    {
+        fromSnapshot(snapshot);
+    }
+
     Turn getTurn() const { return turn; }
 
+    // plies since the last capture or pawn move, and the move number that
+    // starts at 1 and goes up after black moves
+    int getHalfmoveClock() const { return halfmoveClock; }
+    int getFullmoveNumber() const { return fullmoveNumber; }
+
     bool whiteCastle() const { return white.castle(); }
     bool whiteKingSide() const { return white.kingSide(); }
     bool whiteQueenSide() const { return white.queenSide(); }
@@ -350,80 +636,234 @@ public:
     bool blackQueenSide() const { return black.queenSide(); }
 
     bool move(bool& checkMate, bool& draw)
+    {
+        return move(checkMate, draw, RandomPolicy());
+    }
+
+    // play the move policy picks, with the board random number generator
+    template <typename Policy>
+    bool move(bool& checkMate, bool& draw, Policy policy)
     {
         Turn player = getTurn();
-        // get black moves and attacks
-        Moves movesWhite;
-        Moves attacksWhite;
-        // get black moves and attacks
-        Moves movesBlack;
-        Moves attacksBlack;
-        // see if my king is in check on this turn
-        clearAttacks();
-        // remove any king moves into check
-        if (player == White) {
-            // set black attacks
-            blackMoves(movesBlack, attacksBlack);
-            setAttacks(attacksBlack, Black);
-            // get white moves
-            whiteMoves(movesWhite, attacksWhite);
-            removeCheckMoves(movesWhite);
-        } else {
-            // set white attacks
-            whiteMoves(movesWhite, attacksWhite);
-            setAttacks(attacksWhite, White);
-            // get black moves
-            blackMoves(movesBlack, attacksBlack);
-            removeCheckMoves(movesBlack);
-        }
-        // find possible moves if in check
+        // only legal moves, in check they are all the ways out of it
+        Moves movesLegal;
         movesCheck.clear();
-        if (getCheck(player)) {
-            if (player == White) {
-                checkMoves(movesWhite, movesCheck);
-            } else {
-                checkMoves(movesBlack, movesCheck);
-            }
-            if (movesCheck.empty()) {
-                checkMate = true;
-                draw = false;
-                return false;
-            }
-        }
-        // pick our set of moves to chose from
-        const Moves& moves = (player == White)
-                           ? (movesCheck.empty() ? movesWhite : movesCheck)
-                           : (movesCheck.empty() ? movesBlack : movesCheck);
+        const bool check = inCheck(player);
+        Moves& moves = check ? movesCheck : movesLegal;
+        legalMoves(player, moves);
         if (moves.empty()) {
+            checkMate = check;
+            draw = !checkMate;
+            drawReason = draw ? Stalemate : NoDraw;
+            return false;
+        }
+        // a drawn game is over even with moves left
+        drawReason = checkDraw();
+        if (drawReason != NoDraw) {
             checkMate = false;
             draw = true;
             return false;
         }
-        const Move *move = selectMove(moves);
+        const Move *move = policy(*this, moves, rng);
         play(*move);
         checkMate = false;
         draw = false;
-        turn = (player == White) ? Black : White;
         return true;
     }
 
-    const Move *selectMove(const Moves& moves) const
+    // play random legal moves until the game ends or maxPlies are played, only
+    // the position is kept up, there is no game record, captured pieces or
+    // attack counts, InPlay is returned if the game did not end
+    Result playout(int maxPlies)
+    {
+        return playout(maxPlies, rng);
+    }
+
+    Result playout(int maxPlies, Random& random)
+    {
+        return playout(maxPlies, random, RandomPolicy());
+    }
+
+    // a playout with the moves picked by policy
+    template <typename Policy>
+    Result playout(int maxPlies, Random& random, Policy policy)
+    {
+        for (int ply = 0; ply < maxPlies; ++ply) {
+            Moves moves;
+            legalMoves(turn, moves);
+            if (moves.empty()) {
+                if (!inCheck(turn)) { return Draw; }
+                return (turn == White) ? BlackWin : WhiteWin;
+            }
+            if (checkDraw() != NoDraw) { return Draw; }
+            UndoInfo undo;
+            makeMove(*policy(*this, moves, random), undo);
+        }
+        return InPlay;
+    }
+
+    // why move() last found the game drawn, NoDraw if it was not
+    DrawReason getDrawReason() const { return drawReason; }
+
+    // a draw by rule in this position, stalemate needs the move list so
+    // it is left to the caller
+    DrawReason checkDraw() const
+    {
+        if (halfmoveClock >= 100) { return FiftyMoves; }
+        if (insufficientMaterial()) { return InsufficientMaterial; }
+        if (repetitions() >= 2) { return Repetition; }
+        return NoDraw;
+    }
+
+    // how many times this position was seen before, only positions since
+    // the last capture or pawn move with the same side to move can match
+    int repetitions() const
+    {
+        int count = 0;
+        const int back = (halfmoveClock < (int)plies) ? halfmoveClock : (int)plies;
+        for (int i = 4; (i <= back) && (i < KeyHistory); i += 2) {
+            if (keyHistory[(plies - i) & (KeyHistory - 1)] == key) { ++count; }
+        }
+        return count;
+    }
+
+    // neither side can mate, kings alone or with one minor piece, or only
+    // bishops that all stand on squares of one color
+    bool insufficientMaterial() const
+    {
+        if (pieces(Pawn) | pieces(Rook) | pieces(Queen)) { return false; }
+        const Bitboard knights = pieces(Knight);
+        const Bitboard bishops = pieces(Bishop);
+        if (popCount(knights | bishops) <= 1) { return true; }
+        const Bitboard darkSquares = 0xAA55AA55AA55AA55ULL;
+        return !knights && (!(bishops & darkSquares) || !(bishops & ~darkSquares));
+    }
+
+    const Move *selectMove(const Moves& moves)
     {
         return randomMove(moves);
     }
 
-    const Move *randomMove(const Moves& moves) const
+    const Move *randomMove(const Moves& moves)
     {
         if (moves.empty()) { return NULL; }
-        unsigned *pseed = (unsigned *)&seed;
-        unsigned idx = rand_r(pseed) % moves.size();
-        MovesCItr itr = moves.begin();
-        for (unsigned i = 0; i < idx; ++i, ++itr) {}
-        return &(*itr);
+        return &moves[rng.below(moves.size())];
     }
 
-    // move piece from rF, cF, to rT, cT
+    // pick a move with probability in proportion to its prior, priors[i] is
+    // the weight of moves[i], all zero weights fall back to a uniform pick
+    const Move *weightedMove(const Moves& moves, const float *priors)
+    {
+        if (moves.empty()) { return NULL; }
+        // running totals, then a binary search for the first one past the draw
+        float cumulative[MaxMoves];
+        float total = 0;
+        for (unsigned i = 0; i < moves.size(); ++i) {
+            total += (priors[i] > 0) ? priors[i] : 0;
+            cumulative[i] = total;
+        }
+        if (total <= 0) { return randomMove(moves); }
+        const float draw = rng.unit() * total;
+        unsigned lo = 0;
+        unsigned hi = moves.size() - 1;
+        while (lo < hi) {
+            const unsigned mid = (lo + hi) / 2;
+            if (cumulative[mid] > draw) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return &moves[lo];
+    }
+
+    // a random move that does not give away material by static exchange, a
+    // few draws are tried before any move will do
+    const Move *safeMove(const Moves& moves)
+    {
+        return safeMove(moves, rng, 4);
+    }
+
+    const Move *safeMove(const Moves& moves, Random& random, int tries) const
+    {
+        if (moves.empty()) { return NULL; }
+        for (int i = 0; i < tries; ++i) {
+            const Move *move = &moves[random.below(moves.size())];
+            if (see(*move) >= 0) { return move; }
+        }
+        return &moves[random.below(moves.size())];
+    }
+
+    Random& random() { return rng; }
+
+    // make the move and keep it in the game record
     void play(const Move& move)
+    {
+        // only the pieces on the squares the move changes and the sliders
+        // that reach those squares attack anything different afterwards
+        const Bitboard changed = changedSquares(move);
+        const Bitboard recount = changed | (slidersTo(changed, occupied()) & ~changed);
+        countAttacks(recount, -1);
+        UndoInfo undo;
+        makeMove(move, undo);
+        countAttacks(recount, 1);
+        // was a piece captured, it belongs to the side now on turn
+        if (undo.captured != Empty) {
+            Row r = move.isEnpassant() ? move.rowF() : move.rowT();
+            remSidePiece(r, move.colT(), undo.captured, turn);
+        }
+        // remember this move
+        gameMoves.push_back(move);
+    }
+
+    // squares a move empties or fills, including the rook of a castle and
+    // the pawn taken en passant
+    Bitboard changedSquares(const Move& move) const
+    {
+        Bitboard changed = squareBB(move.from()) | squareBB(move.to());
+        if (move.isEnpassant()) {
+            changed |= squareBB(squareOf(move.rowF(), move.colT()));
+        }
+        if (move.isCastle()) {
+            const int r = rowOf(move.from());
+            changed |= squareBB(squareOf(r, move.isKingSide() ? ch : ca));
+            changed |= squareBB(squareOf(r, move.isKingSide() ? cf : cd));
+        }
+        return changed;
+    }
+
+    // rooks, bishops and queens of either side that attack any of squares
+    Bitboard slidersTo(Bitboard squares, Bitboard occ) const
+    {
+        const Bitboard rooks = pieces(Rook) | pieces(Queen);
+        const Bitboard bishops = pieces(Bishop) | pieces(Queen);
+        Bitboard sliders = 0;
+        while (squares) {
+            const int sq = popLsb(squares);
+            sliders |= (rookAttacks(sq, occ) & rooks) | (bishopAttacks(sq, occ) & bishops);
+        }
+        return sliders;
+    }
+
+    // add or take away the attacks of the pieces on squares
+    void countAttacks(Bitboard squares, int delta)
+    {
+        const Bitboard occ = occupied();
+        squares &= occ;
+        while (squares) {
+            const int sq = popLsb(squares);
+            const Side side = sideOn(sq);
+            unsigned char *counts = attackCount[sideIndex(side)];
+            Bitboard attacks = pieceAttacks(pieceOn(sq), side, sq, occ);
+            while (attacks) {
+                counts[popLsb(attacks)] += delta;
+            }
+        }
+    }
+
+    // move piece from rF, cF, to rT, cT and pass the turn, undo keeps what
+    // is needed to take the move back with unmakeMove
+    void makeMove(const Move& move, UndoInfo& undo)
     {
         const Row rF = move.rowF();
         const Col cF = move.colF();
@@ -435,686 +875,782 @@ public:
         // get to piece
         Piece pT; Side sT;
         whoIs(rT, cT, pT, sT);
+        // remember the state this move changes
+        undo.moved = pF;
+        undo.captured = move.isEnpassant() ? Pawn : pT;
+        undo.white = white;
+        undo.black = black;
+        undo.epSquare = epSquare;
+        undo.halfmoveClock = halfmoveClock;
+        keyHistory[plies++ & (KeyHistory - 1)] = key;
+        undo.key = key;
+        undo.whiteCheck = whiteCheck;
+        undo.blackCheck = blackCheck;
+        undo.promotion = promotion;
+        undo.castle = castle;
+        undo.enpassant = enpassant;
+        promotion = false;
+        castle = false;
+        enpassant = false;
         // keep track of castling
-        if (sF == White) {
-            white.checkMove(rF, cF, pF, sF);
-        } else {
-            black.checkMove(rF, cF, pF, sF);
+        key ^= castleKey();
+        castleRights(sF).checkMove(rF, cF, pF, sF);
+        // a captured rook can no longer castle
+        if ((pT != Empty) && (sT != None)) {
+            castleRights(sT).checkMove(rT, cT, pT, sT);
         }
+        key ^= castleKey();
         // clear our from square
         clearSquare(rF, cF);
-        // set our to square
+        // set our to square, this also clears any captured piece
         setBoardPiece(rT, cT, pF, sF);
-        // update our side piece
-        updSidePiece(rF, cF, rT, cT, pF, sF);
+        // check on promotion
+        doPromotion(move, sF);
         // check on enpassant
         doEnpassant(move);
         // check on castling
-        doCastle(move);
-        // was a piece captured 
-        if ((pT != Empty) && (sT != None)) {
-            remSidePiece(rT, cT, pT, sT);
+        doCastle(move, sF);
+        // a pawn that moved two squares can be taken en passant on the next move
+        // if a pawn of the other side is there to take it
+        key ^= enpassantKey();
+        epSquare = NoSquare;
+        if ((pF == Pawn) && ((rT - rF == 2) || (rF - rT == 2))) {
+            const int sq = squareOf((rF + rT) / 2, cT);
+            if (pawnAttacks(sideIndex(sF), sq) & pieces(opponent(sF), Pawn)) {
+                epSquare = sq;
+            }
         }
-        // remember this move
-        gameMoves.push_back(move);
+        key ^= enpassantKey();
+        // captures and pawn moves restart the fifty move count
+        halfmoveClock = ((pF == Pawn) || (undo.captured != Empty)) ? 0 : halfmoveClock + 1;
+        if (sF == Black) { ++fullmoveNumber; }
+        // pass the turn and see if the move checks the other king
+        turn = opponent(sF);
+        key ^= Zobrist::get().turn;
+        whiteCheck = (turn == White) && inCheck(White);
+        blackCheck = (turn == Black) && inCheck(Black);
+    }
+
+    // take back a move made with makeMove
+    void unmakeMove(const Move& move, const UndoInfo& undo)
+    {
+        const Row rF = move.rowF();
+        const Col cF = move.colF();
+        const Row rT = move.rowT();
+        const Col cT = move.colT();
+        const Side sF = opponent(turn);
+        // put the rook back
+        undoCastle(move, sF);
+        // put the moved piece back, a promoted piece is a pawn again
+        clearSquare(rT, cT);
+        setBoardPiece(rF, cF, undo.moved, sF);
+        // put the captured piece back
+        if (undo.captured != Empty) {
+            Row r = move.isEnpassant() ? rF : rT;
+            setBoardPiece(r, cT, undo.captured, turn);
+        }
+        turn = sF;
+        white = undo.white;
+        black = undo.black;
+        epSquare = undo.epSquare;
+        halfmoveClock = undo.halfmoveClock;
+        if (sF == Black) { --fullmoveNumber; }
+        --plies;
+        key = undo.key;
+        whiteCheck = undo.whiteCheck;
+        blackCheck = undo.blackCheck;
+        promotion = undo.promotion;
+        castle = undo.castle;
+        enpassant = undo.enpassant;
+    }
+
+    void doPromotion(const Move& move, Side sF)
+    {
+        if (!move.isPromotion()) { return; }
+        setBoardPiece(move.rowT(), move.colT(), move.getPromotion(), sF);
+        // set promotion flag
+        promotion = true;
     }
 
     void doEnpassant(const Move& move)
     {
         if (!move.isEnpassant()) { return; }
-        Row rT = move.rowF();
-        Col cT = move.colT();
-        // get to piece
-        Piece pT; Side sT;
-        whoIs(rT, cT, pT, sT);
-        clearSquare(rT, cT);
-        remSidePiece(rT, cT, pT, sT);
+        clearSquare(move.rowF(), move.colT());
         // set enpassant flag
         enpassant = true;
     }
 
-    void doCastle(const Move& move)
+    void doCastle(const Move& move, Side sF)
     {
         if (!move.isCastle()) { return; }
         // which Rook to move?
         Piece pF = Rook;
-        Side sF = move.isWhite() ? White : Black;
-        Row rF = move.isWhite() ? r1 : r8;
+        Row rF = (sF == White) ? r1 : r8;
         Col cF = move.isKingSide() ? ch : ca;
-        Row rT = move.isWhite() ? r1 : r8;
+        Row rT = rF;
         Col cT = move.isKingSide() ? cf : cd;
         // clear our from square
         clearSquare(rF, cF);
         // set our to square
         setBoardPiece(rT, cT, pF, sF);
-        // update our side piece
-        updSidePiece(rF, cF, rT, cT, pF, sF);
         // set castle flag
         castle = true;
     }
 
-    const Square& getSquare(const Row r, const Col c) const { return board[r][c]; }
-    void clearSquare(const Row r, const Col c) { board[r][c].clear(); }
+    void undoCastle(const Move& move, Side side)
+    {
+        if (!move.isCastle()) { return; }
+        Row r = (side == White) ? r1 : r8;
+        Col cF = move.isKingSide() ? ch : ca;
+        Col cT = move.isKingSide() ? cf : cd;
+        clearSquare(r, cT);
+        setBoardPiece(r, cF, Rook, side);
+    }
 
-    void whoIs(const Row r, const Col c, Piece& p, Side& s) const { board[r][c].whoIs(p, s); }
-    bool isOpen(const Row r, const Col c) const { return board[r][c].isOpen(); }
-    bool isWhite(const Row r, const Col c) const { return board[r][c].isWhite(); }
-    bool isBlack(const Row r, const Col c) const { return board[r][c].isBlack(); }
+    Castle& castleRights(Side side) { return (side == White) ? white : black; }
+    const Castle& castleRights(Side side) const { return (side == White) ? white : black; }
 
-    void getAllMovesTo(const Moves& moves, Row rT, Col cT, Moves& movesChk) const
+    // set up castling rights for a position built with setBoardPiece
+    void setCastle(Side side, bool kingSide, bool queenSide)
     {
-        MovesCItr itr = moves.begin();
-        for (; itr != moves.end(); ++itr) {
-            const Move& move = *itr;
-            if ((move.rowT() == rT) && (move.colT() == cT)) {
-                if (move.getPiece() == King) {
-                    // can only move king to this position if it is not under attack by other side
-                    if (  ((move.getSide() == White) && (board[rT][cT].getAttackBlack() == 0))
-                       || ((move.getSide() == Black) && (board[rT][cT].getAttackWhite() == 0))) {
-                        movesChk.insert(move);
-                    }
-                } else {
-                    movesChk.insert(move);
-                }
-            }
-        }
+        key ^= castleKey();
+        castleRights(side).set(kingSide, queenSide);
+        key ^= castleKey();
     }
 
-    void getAllKingMoves(const Moves& moves, Moves& movesChk) const
+    // count the leaf nodes of the legal move tree depth plies deep, with bulk
+    // the last ply is counted from the move list without playing it
+    uint64_t perft(int depth, bool bulk = true)
     {
-        MovesCItr itr = moves.begin();
-        for (; itr != moves.end(); ++itr) {
-            const Move& move = *itr;
-            if (move.getPiece() == King) {
-                movesChk.insert(move);
-            }
+        if (depth <= 0) { return 1; }
+        Moves moves;
+        legalMoves(turn, moves);
+        if (bulk && (depth == 1)) { return moves.size(); }
+        uint64_t nodes = 0;
+        for (unsigned i = 0; i < moves.size(); ++i) {
+            nodes += perft(moves[i], depth, bulk);
         }
+        return nodes;
     }
 
-    void removeCheckMoves(Moves& moves) const
+    // leaf nodes below a single move, the per move count of a divide
+    uint64_t perft(const Move& move, int depth, bool bulk = true)
     {
-        // find in check moves
-        std::list<Move> inCheck;
-        MovesCItr itr = moves.begin();
-        for (; itr != moves.end(); ++itr) {
-            const Move& move = *itr;
-            if (move.getPiece() == King) {
-                Row rT = move.rowT(); Col cT = move.colT();
-                if (  ((move.getSide() == White) && (board[rT][cT].getAttackBlack()))
-                   || ((move.getSide() == Black) && (board[rT][cT].getAttackWhite()))) {
-                    inCheck.push_back(move);
-                }
-            }
-        }
-        // remove in check moves
-        std::list<Move>::iterator itr2 = inCheck.begin();
-        for (; itr2 != inCheck.end(); ++itr2) {
-            moves.erase(*itr2);
-        }
-    }
-
-    void checkBlockRookMoves(const Moves& moves, Moves& movesChk) const
-    {
-        if (!checkAttacker) { return; }
-        // rook is at rF, cF
-        Row rF = checkAttacker->rowF();
-        Col cF = checkAttacker->colF();
-        // king is at rT, cT
-        Row rT = checkAttacker->rowT();
-        Col cT = checkAttacker->colT();
-        /*
-         *       c   d   e   f   g
-         *     *---*---*---*---*---*
-         *   6 |   |   | R |   |   |
-         *     *---*---*---*---*---*
-         *   5 |   |   | x |   |   |
-         *     *---*---*---*---*---*
-         *   4 | R | x | K | x | R | rF == rT
-         *     *---*---*---*---*---*
-         *   3 |   |   | x |   |   |
-         *     *---*---*---*---*---*
-         *   2 |   |   | R |   |   |
-         *     *---*---*---*---*---*
-         *            cF == cT
-         */
-        if (rF == rT) {
-            // row attack
-            if (cF < cT) {
-                for (int c = cF + 1; c < cT; ++c) {
-                    getAllMovesTo(moves, rF, (Col)c, movesChk);
-                }
-            } else if (cF > cT) {
-                for (int c = cF - 1; c > cT; --c) {
-                    getAllMovesTo(moves, rF, (Col)c, movesChk);
-                }
-            }
-        } else if (cF == cT) {
-            // column attack
-            if (rF < rT) {
-                for (int r = rF + 1; r < rT; ++r) {
-                    getAllMovesTo(moves, (Row)r, cF, movesChk);
-                }
-            } else if (rF > rT) {
-                for (int r = rF - 1; r > rT; --r) {
-                    getAllMovesTo(moves, (Row)r, cF, movesChk);
-                }
-            }
-        }
+        UndoInfo undo;
+        makeMove(move, undo);
+        const uint64_t nodes = perft(depth - 1, bulk);
+        unmakeMove(move, undo);
+        return nodes;
     }
 
-    void checkBlockBishopMoves(const Moves& moves, Moves& movesChk) const
-    {
-        if (!checkAttacker) { return; }
-        // bishop is at rF, cF
-        Row rF = checkAttacker->rowF();
-        Col cF = checkAttacker->colF();
-        // king is at rT, cT
-        Row rT = checkAttacker->rowT();
-        Col cT = checkAttacker->colT();
-        /*
-         *       c   d   e   f   g
-         *     *---*---*---*---*---*
-         *   6 | B |   |   |   | B |
-         *     *---*---*---*---*---*
-         *   5 |   | x |   | x |   | rF > rT
-         *     *---*---*---*---*---*
-         *   4 |   |   | K |   |   |
-         *     *---*---*---*---*---*
-         *   3 |   | x |   | x |   | rF < rT
-         *     *---*---*---*---*---*
-         *   2 | B |   |   |   | B |
-         *     *---*---*---*---*---*
-         *      cF < cT    cF > cT
-         */
-        if (rF < rT) {
-            int r = rF + 1;
-            if (cF < cT) {
-                int c = cF + 1;
-                for (; r < rT && c < cT; ++r, ++c) {
-                    getAllMovesTo(moves, (Row)r, (Col)c, movesChk);
-                }
-            } else if (cF > cT) {
-                int c = cF - 1;
-                for (; r < rT && c > cT; ++r, --c) {
-                    getAllMovesTo(moves, (Row)r, (Col)c, movesChk);
-                }
-            }
-        }
-        else if (rF > rT) {
-            int r = rF - 1;
-            if (cF < cT) {
-                int c = cF + 1;
-                for (; r > rT && c < cT; --r, ++c) {
-                    getAllMovesTo(moves, (Row)r, (Col)c, movesChk);
-                }
-            } else if (cF > cT) {
-                int c = cF - 1;
-                for (; r > rT && c > cT; --r, --c) {
-                    getAllMovesTo(moves, (Row)r, (Col)c, movesChk);
-                }
-            }
-        }
+    // a view of the square built from the bitboards and attack counts
+    Square getSquare(const Row r, const Col c) const
+    {
+        const int sq = squareOf(r, c);
+        return Square((((r + c) % 2) == 0) ? Dark : Light, r, c,
+                      pieceOn(sq), sideOn(sq),
+                      attackCount[0][sq], attackCount[1][sq]);
     }
 
-    // all possible king moves while my king is in check
-    void checkMoves(const Moves& moves, Moves& movesChk) const
+    void clearSquare(const Row r, const Col c) { removePiece(squareOf(r, c)); }
+
+    void whoIs(const Row r, const Col c, Piece& p, Side& s) const
     {
-        if (!checkAttacker) { return; }
-        Piece piece = checkAttacker->getPiece();
-        // attacker is at rF, cF
-        Row rF = checkAttacker->rowF();
-        Col cF = checkAttacker->colF();
-        // all moves that can kill the attacker
-        getAllMovesTo(moves, rF, cF, movesChk);
-        // all moves that can block the attacker
-        switch (piece)
-        {
-        case Empty:
-            break;
-        case Pawn:
-            // not possible to block pawn check attacks
-            break;
-        case Rook:
-            checkBlockRookMoves(moves, movesChk);
-            break;
-        case Knight:
-            // not possible to block knight check attacks
-            break;
-        case Bishop:
-            checkBlockBishopMoves(moves, movesChk);
-            break;
-        case Queen:
-            checkBlockRookMoves(moves, movesChk);
-            checkBlockBishopMoves(moves, movesChk);
-            break;
-        case King:
-            // King can never place another King in check
-            break;
-        }
-        // get all king moves to squares not in check
-        getAllKingMoves(moves, movesChk);
+        const int sq = squareOf(r, c);
+        p = pieceOn(sq);
+        s = sideOn(sq);
     }
 
-    void whiteMoves(Moves& moves, Moves& attacks) const
+    bool isOpen(const Row r, const Col c) const { return !(occupied() & squareBB(squareOf(r, c))); }
+    bool isWhite(const Row r, const Col c) const { return (occupied(White) & squareBB(squareOf(r, c))) != 0; }
+    bool isBlack(const Row r, const Col c) const { return (occupied(Black) & squareBB(squareOf(r, c))) != 0; }
+
+    Bitboard pieces(Side s, Piece p) const { return pieceBB[sideIndex(s)][p - Pawn]; }
+    Bitboard occupied(Side s) const { return sideBB[sideIndex(s)]; }
+    Bitboard occupied() const { return sideBB[0] | sideBB[1]; }
+
+    Piece pieceOn(int sq) const { return (Piece)(mailbox[sq] & 7); }
+    Side sideOn(int sq) const { return (Side)(mailbox[sq] >> 3); }
+
+    Bitboard pieces(Piece p) const { return pieceBB[0][p - Pawn] | pieceBB[1][p - Pawn]; }
+
+    // every piece of either side attacking sq
+    Bitboard attackersTo(int sq, Bitboard occ) const
     {
-        sideMoves(whitePieces, moves, attacks);
+        return (pawnAttacks(1, sq) & pieces(White, Pawn))
+             | (pawnAttacks(0, sq) & pieces(Black, Pawn))
+             | (knightAttacks(sq) & pieces(Knight))
+             | (kingAttacks(sq) & pieces(King))
+             | (bishopAttacks(sq, occ) & (pieces(Bishop) | pieces(Queen)))
+             | (rookAttacks(sq, occ) & (pieces(Rook) | pieces(Queen)));
     }
 
-    void blackMoves(Moves& moves, Moves& attacks) const
+    // is sq attacked by a piece of side, looking out from sq with the
+    // knight, king and pawn patterns and the slider rays
+    bool isAttacked(int sq, Side side, Bitboard occ) const
     {
-        sideMoves(blackPieces, moves, attacks);
+        return (pawnAttacks(sideIndex(opponent(side)), sq) & pieces(side, Pawn)) ||
+               (knightAttacks(sq) & pieces(side, Knight)) ||
+               (kingAttacks(sq) & pieces(side, King)) ||
+               (bishopAttacks(sq, occ) & (pieces(side, Bishop) | pieces(side, Queen))) ||
+               (rookAttacks(sq, occ) & (pieces(side, Rook) | pieces(side, Queen)));
     }
 
-    void sideMoves(const Moves& pieces, Moves& moves, Moves& attacks) const
+    bool isAttacked(int sq, Side side) const { return isAttacked(sq, side, occupied()); }
+
+    // a side without a king, as on an empty board, is never in check
+    bool inCheck(Side side) const
     {
-        moves.clear();
-        attacks.clear();
-        MovesCItr itr = pieces.begin();
-        for (; itr != pieces.end(); ++itr) {
-            const Move& piece = *itr;
-            switch (piece.getPiece())
-            {
-            case Empty: break;
-            case Pawn: pawnMoves(piece, moves, attacks); break;
-            case Rook: rookMoves(piece, moves, attacks); break;
-            case Knight: knightMoves(piece, moves, attacks); break;
-            case Bishop: bishopMoves(piece, moves, attacks); break;
-            case Queen: queenMoves(piece, moves, attacks); break;
-            case King: kingMoves(piece, moves, attacks); break;
-            }
-        }
+        const Bitboard king = pieces(side, King);
+        return king && isAttacked(lsb(king), opponent(side));
     }
 
-    void pawnMoves(const Move& piece, Moves& moves, Moves& attacks) const
+    // pieces of the other side attacking the king of side
+    Bitboard checkers(Side side) const
     {
-        if (piece.isWhite()) {
-            pawnWhiteMoves(piece, moves, attacks);
-        } else if (piece.isBlack()) {
-            pawnBlackMoves(piece, moves, attacks);
-        }
+        const Bitboard king = pieces(side, King);
+        return king ? attackersTo(lsb(king), occupied()) & occupied(opponent(side)) : 0;
     }
 
-    void pawnWhiteMoves(const Move& piece, Moves& moves, Moves& attacks) const
+    // static exchange evaluation, the material the side making move wins
+    // once all captures on its target square are played out, least valuable
+    // attacker first, sliders lined up behind others join in as the pieces
+    // in front of them go, either side stops taking when it would lose by
+    // going on, pins are not looked at, a quiet move onto a square the other
+    // side wins gets the value of the piece lost
+    int see(const Move& move) const
     {
-        Row rF; Col cF;
-        piece.getFrom(rF, cF);
-        if (rF == r8) { return; }
-        Row rT = (Row)(rF + 1);
-        Col cT = cF;
-        // can move one ahead
-        if (isOpen(rT, cT)) {
-            insert(moves, Move(Pawn, White, rF, cF, rT, cT));
+        if (move.isCastle()) { return 0; }
+        const int from = move.from();
+        const int to = move.to();
+        int gain[32];
+        int depth = 0;
+        Bitboard occ = occupied() ^ squareBB(from);
+        Piece onSquare = pieceOn(from);
+        gain[0] = PieceValues[pieceOn(to)];
+        if (move.isEnpassant()) {
+            occ ^= squareBB(squareOf(rowOf(from), colOf(to)));
+            gain[0] = PieceValues[Pawn];
         }
-        // check left
-        cT = (Col)(cF - 1);
-        if (cF != ca) {
-            // can always attack left
-            insert(attacks, Move(Pawn, White, rF, cF, rT, cT));
-            if (isBlack(rT, cT)) {
-                // can move also
-                insert(moves, Move(Pawn, White, rF, cF, rT, cT));
-            }
+        if (move.isPromotion()) {
+            onSquare = move.getPromotion();
+            gain[0] += PieceValues[onSquare] - PieceValues[Pawn];
         }
-        // check right
-        cT = (Col)(cF + 1);
-        if (cF != ch) {
-            // can always attack right
-            insert(attacks, Move(Pawn, White, rF, cF, rT, cT));
-            if (isBlack(rT, cT)) {
-                // can move also
-                insert(moves, Move(Pawn, White, rF, cF, rT, cT));
+        const Bitboard bishops = pieces(Bishop) | pieces(Queen);
+        const Bitboard rooks = pieces(Rook) | pieces(Queen);
+        Bitboard attackers = attackersTo(to, occ) & occ;
+        Side side = opponent(sideOn(from));
+        for (;;) {
+            const Bitboard ours = attackers & occupied(side);
+            if (!ours) { break; }
+            Piece piece = Pawn;
+            Bitboard bb = 0;
+            static const Piece order[] = { Pawn, Knight, Bishop, Rook, Queen, King };
+            for (unsigned i = 0; i < sizeof(order) / sizeof(order[0]); ++i) {
+                piece = order[i];
+                bb = ours & pieces(side, piece);
+                if (bb) { break; }
             }
-        }
-        // can move two on first move
-        if (firstPawnMove(rF, White)) {
-            Row rT = r4;
-            Col cT = cF;
-            if (isOpen(r3, cT) && isOpen(r4, cT)) {
-                insert(moves, Move(Pawn, White, rF, cF, rT, cT));
+            // the king cannot take onto a square the other side still attacks
+            if ((piece == King) && (attackers & occupied(opponent(side)))) { break; }
+            ++depth;
+            // what this side is up if nothing takes back
+            gain[depth] = PieceValues[onSquare] - gain[depth - 1];
+            occ ^= squareBB(lsb(bb));
+            if ((piece == Pawn) || (piece == Bishop) || (piece == Queen)) {
+                attackers |= bishopAttacks(to, occ) & bishops;
             }
-        }
-        // handle En passant for White
-        if (1)
-        {
-            Row rT;
-            Col cT;
-            if (lastMoveCanEnpassant(rF, cF, White, rT, cT)) {
-                insert(moves, Move(Pawn, White, rF, cF, rT, cT, EN_PASSANT));
+            if ((piece == Rook) || (piece == Queen)) {
+                attackers |= rookAttacks(to, occ) & rooks;
             }
+            attackers &= occ;
+            onSquare = piece;
+            side = opponent(side);
+            if (depth == 31) { break; }
         }
+        // each side picks the better of taking or not, from the last capture back
+        for (; depth > 0; --depth) {
+            if (-gain[depth] < gain[depth - 1]) { gain[depth - 1] = -gain[depth]; }
+        }
+        return gain[0];
     }
 
-    void pawnBlackMoves(const Move& piece, Moves& moves, Moves& attacks) const
+    Bitboard pieceAttacks(Piece piece, Side side, int sq, Bitboard occ) const
     {
-        Row rF; Col cF;
-        piece.getFrom(rF, cF);
-        if (rF == r1) { return; }
-        Row rT = (Row)(rF - 1);
-        Col cT = cF;
-        // can move one ahead
-        if (isOpen(rT, cT)) {
-            insert(moves, Move(Pawn, Black, rF, cF, rT, cT));
-        }
-        // check left
-        cT = (Col)(cF + 1);
-        if (cF != ch) {
-            // can attack left
-            insert(attacks, Move(Pawn, Black, rF, cF, rT, cT));
-            if (isWhite(rT, cT)) {
-                // can move also
-                insert(moves, Move(Pawn, Black, rF, cF, rT, cT));
-            }
-        }
-        // check right
-        cT = (Col)(cF - 1);
-        if (cF != ca) {
-            // can attack right
-            insert(attacks, Move(Pawn, Black, rF, cF, rT, cT));
-            if (isWhite(rT, cT)) {
-                // can move also
-                insert(moves, Move(Pawn, Black, rF, cF, rT, cT));
-            }
-        }
-        // can move two on first move
-        if (firstPawnMove(rF, Black)) {
-            Row rT = r5;
-            Col cT = cF;
-            if (isOpen(r6, cT) && isOpen(r5, cT)) {
-                insert(moves, Move(Pawn, Black, rF, cF, rT, cT));
-            }
-        }
-        // handle En passant for Black
-        if (1)
+        switch (piece)
         {
-            Row rT;
-            Col cT;
-            if (lastMoveCanEnpassant(rF, cF, Black, rT, cT)) {
-                insert(moves, Move(Pawn, Black, rF, cF, rT, cT, EN_PASSANT));
-            }
+        case Pawn: return pawnAttacks(sideIndex(side), sq);
+        case Rook: return rookAttacks(sq, occ);
+        case Knight: return knightAttacks(sq);
+        case Bishop: return bishopAttacks(sq, occ);
+        case Queen: return queenAttacks(sq, occ);
+        case King: return kingAttacks(sq);
+        default: return 0;
         }
     }
 
-    void knightMoves(const Move& piece, Moves& moves, Moves& attacks) const
-    {
-        Row rF; Col cF;
-        piece.getFrom(rF, cF);
-        // forward
-        knightMove(piece, moves, attacks, rF, cF, rF + 2, cF + 1);
-        knightMove(piece, moves, attacks, rF, cF, rF + 2, cF - 1);
-        knightMove(piece, moves, attacks, rF, cF, rF + 1, cF + 2);
-        knightMove(piece, moves, attacks, rF, cF, rF + 1, cF - 2);
-        // back
-        knightMove(piece, moves, attacks, rF, cF, rF - 2, cF + 1);
-        knightMove(piece, moves, attacks, rF, cF, rF - 2, cF - 1);
-        knightMove(piece, moves, attacks, rF, cF, rF - 1, cF + 2);
-        knightMove(piece, moves, attacks, rF, cF, rF - 1, cF - 2);
-    }
-
-    void knightMove(const Move& piece, Moves& moves, Moves& attacks, Row rF, Col cF, int _rT, int _cT) const
+    // pieces of side that are the only thing between their king and an enemy slider
+    Bitboard pinnedPieces(Side side, int ksq) const
     {
-        if (offBoard(_rT, _cT)) { return; }
-        Row rT = (Row)_rT; Col cT = (Col)_cT;
-        // can always attack
-        insert(attacks, Move(Knight, piece.getSide(), rF, cF, rT, cT));
-        if (canKnightMove(piece, rT, cT)) {
-            // can move also
-            insert(moves, Move(Knight, piece.getSide(), rF, cF, rT, cT));
+        const Side them = opponent(side);
+        const Bitboard occ = occupied();
+        Bitboard pinned = 0;
+        Bitboard snipers = (rookAttacks(ksq, 0) & (pieces(them, Rook) | pieces(them, Queen)))
+                         | (bishopAttacks(ksq, 0) & (pieces(them, Bishop) | pieces(them, Queen)));
+        while (snipers) {
+            const Bitboard blockers = between(ksq, popLsb(snipers)) & occ;
+            if (blockers && !(blockers & (blockers - 1))) {
+                pinned |= blockers & occupied(side);
+            }
         }
+        return pinned;
     }
 
-    bool canKnightMove(const Move& piece, Row rT, Col cT) const
+    // all legal moves for side in one pass, using the pieces checking and
+    // pinned to the king and the squares the other side attacks
+    void legalMoves(Side side, Moves& moves) const
     {
-        if (  isOpen(rT, cT)
-           || (piece.isWhite() && isBlack(rT, cT)) 
-           || (piece.isBlack() && isWhite(rT, cT))) {
-            return true;
+        if (side == White) {
+            legalMoves<White>(moves);
+        } else {
+            legalMoves<Black>(moves);
         }
-        return false;
-    }
-
-    bool offBoard(int rT, int cT) const
-    {
-        if (rT < r1 || rT > r8) { return true; }
-        if (cT < ca || cT > ch) { return true; }
-        return false;
-    }
-
-    void rookMoves(const Move& piece, Moves& moves, Moves& attacks) const
-    {
-        moveN(piece, moves, attacks, 7);
-        moveE(piece, moves, attacks, 7);
-        moveS(piece, moves, attacks, 7);
-        moveW(piece, moves, attacks, 7);
     }
 
-    void bishopMoves(const Move& piece, Moves& moves, Moves& attacks) const
-    {
-        moveNE(piece, moves, attacks, 7);
-        moveSE(piece, moves, attacks, 7);
-        moveSW(piece, moves, attacks, 7);
-        moveNW(piece, moves, attacks, 7);
+    // the generators are built once for each side so the side is a constant
+    // and there are no color branches in their loops
+    template <Side Us>
+    void legalMoves(Moves& moves) const
+    {
+        const Side Them = (Us == White) ? Black : White;
+        const Bitboard occ = occupied();
+        const Bitboard own = occupied(Us);
+        // no moves without a king, lsb(0) is undefined
+        if (!pieces(Us, King)) { return; }
+        const int ksq = lsb(pieces(Us, King));
+        const Bitboard checking = attackersTo(ksq, occ) & occupied(Them);
+        // the king does not shield the squares behind it from a slider
+        const Bitboard kingOcc = occ ^ squareBB(ksq);
+        Bitboard kingTo = kingAttacks(ksq) & ~own;
+        while (kingTo) {
+            const int to = popLsb(kingTo);
+            if (!isAttacked(to, Them, kingOcc)) {
+                moves.insert(Move(ksq, to));
+            }
+        }
+        // in double check only the king can move
+        if (checking & (checking - 1)) { return; }
+        // in check the other pieces must capture or block the checker
+        Bitboard targets = ~own;
+        if (checking) {
+            targets = checking | between(ksq, lsb(checking));
+        } else {
+            moveCastle<Us>(moves);
+        }
+        const Bitboard pinned = pinnedPieces(Us, ksq);
+        // a pinned knight can never move
+        Bitboard bb = pieces(Us, Knight) & ~pinned;
+        while (bb) {
+            const int sq = popLsb(bb);
+            addMoves(moves, sq, knightAttacks(sq) & targets);
+        }
+        bb = pieces(Us, Bishop);
+        while (bb) {
+            const int sq = popLsb(bb);
+            addMoves(moves, sq, bishopAttacks(sq, occ) & pinTargets(sq, ksq, pinned, targets));
+        }
+        bb = pieces(Us, Rook);
+        while (bb) {
+            const int sq = popLsb(bb);
+            addMoves(moves, sq, rookAttacks(sq, occ) & pinTargets(sq, ksq, pinned, targets));
+        }
+        bb = pieces(Us, Queen);
+        while (bb) {
+            const int sq = popLsb(bb);
+            addMoves(moves, sq, queenAttacks(sq, occ) & pinTargets(sq, ksq, pinned, targets));
+        }
+        // pawns that are not pinned all move together, a pinned one only
+        // along the line to its king
+        const Bitboard pawns = pieces(Us, Pawn);
+        pawnMoves<Us>(pawns & ~pinned, targets, moves);
+        bb = pawns & pinned;
+        while (bb) {
+            const int sq = popLsb(bb);
+            pawnMoves<Us>(squareBB(sq), targets & line(ksq, sq), moves);
+        }
+        enpassantMoves<Us>(ksq, targets, moves);
+    }
+
+    // a pinned piece may only move along the line through it and its king
+    Bitboard pinTargets(int sq, int ksq, Bitboard pinned, Bitboard targets) const
+    {
+        return (pinned & squareBB(sq)) ? (targets & line(ksq, sq)) : targets;
+    }
+
+    // pushes and captures of a set of pawns, one shift of the whole set for
+    // each way a pawn can move
+    template <Side Us>
+    void pawnMoves(Bitboard pawns, Bitboard targets, Moves& moves) const
+    {
+        const Side Them = (Us == White) ? Black : White;
+        const int Up = (Us == White) ? 8 : -8;
+        const Bitboard SecondPush = (Us == White) ? Rank3 : Rank6;
+        const Bitboard open = ~occupied();
+        const Bitboard enemies = occupied(Them);
+        // can move one ahead, and two on the first move
+        const Bitboard single = shift<Up>(pawns) & open;
+        const Bitboard twice = shift<Up>(single & SecondPush) & open;
+        addPawnMoves(moves, single & targets, Up);
+        addPawnMoves(moves, twice & targets, 2 * Up);
+        // can move left or right onto the other side
+        addPawnMoves(moves, shift<Up - 1>(pawns & ~FileA) & enemies & targets, Up - 1);
+        addPawnMoves(moves, shift<Up + 1>(pawns & ~FileH) & enemies & targets, Up + 1);
+    }
+
+    template <Side Us>
+    void enpassantMoves(int ksq, Bitboard targets, Moves& moves) const
+    {
+        const Side Them = (Us == White) ? Black : White;
+        const int to = enpassantSquare();
+        if (to == NoSquare) { return; }
+        // the pawn that moved two squares
+        const int pawn = (Us == White) ? to - 8 : to + 8;
+        // in check this must capture the checker or block it
+        if (!(targets & (squareBB(to) | squareBB(pawn)))) { return; }
+        const Bitboard rooks = pieces(Them, Rook) | pieces(Them, Queen);
+        const Bitboard bishops = pieces(Them, Bishop) | pieces(Them, Queen);
+        Bitboard bb = pawnAttacks(sideIndex(Them), to) & pieces(Us, Pawn);
+        while (bb) {
+            const int sq = popLsb(bb);
+            // both pawns leave the rank, that must not uncover an attack on the king
+            const Bitboard occ = (occupied() ^ squareBB(sq) ^ squareBB(pawn)) | squareBB(to);
+            if ((rookAttacks(ksq, occ) & rooks) || (bishopAttacks(ksq, occ) & bishops)) {
+                continue;
+            }
+            moves.insert(Move(sq, to, Move::Enpassant));
+        }
     }
 
-    void queenMoves(const Move& piece, Moves& moves, Moves& attacks) const
+    void addMoves(Moves& moves, int sq, Bitboard targets) const
     {
-        rookMoves(piece, moves, attacks);
-        bishopMoves(piece, moves, attacks);
+        while (targets) {
+            moves.insert(Move(sq, popLsb(targets)));
+        }
     }
 
-    void kingMoves(const Move& piece, Moves& moves, Moves& attacks) const
+    // pawn moves to targets from offset squares back, a pawn reaching the
+    // last row can become any of four pieces
+    void addPawnMoves(Moves& moves, Bitboard targets, int offset) const
     {
-        moveN(piece, moves, attacks, 1);
-        moveE(piece, moves, attacks, 1);
-        moveS(piece, moves, attacks, 1);
-        moveW(piece, moves, attacks, 1);
-        moveNE(piece, moves, attacks, 1);
-        moveSE(piece, moves, attacks, 1);
-        moveSW(piece, moves, attacks, 1);
-        moveNW(piece, moves, attacks, 1);
-        moveCastle(piece, moves);
+        Bitboard promotions = targets & (Rank1 | Rank8);
+        targets &= ~promotions;
+        while (targets) {
+            const int to = popLsb(targets);
+            moves.insert(Move(to - offset, to));
+        }
+        while (promotions) {
+            const int to = popLsb(promotions);
+            moves.insert(Move(to - offset, to, Move::Promotion, Queen));
+            moves.insert(Move(to - offset, to, Move::Promotion, Knight));
+            moves.insert(Move(to - offset, to, Move::Promotion, Rook));
+            moves.insert(Move(to - offset, to, Move::Promotion, Bishop));
+        }
     }
 
-    void moveCastle(const Move& piece, Moves& moves) const
-    {
-        Side side = piece.getSide();
-        if (side == White) {
-/*
-    *----*----*----*----*----*----*----*----*
-  1 | Rw |    |    |    | Kw |    |    | Rw |  1
-    *----*----*----*----*----*----*----*----*
-       a    b    c    d    e    f    g    h  
-*/
-            if (whiteCheck) { return; }
-            if (white.kingSide()) {
-                if (   board[r1][cf].isOpen()
-                   &&  board[r1][cg].isOpen()
-                   && !board[r1][cf].getAttackBlack()
-                   && !board[r1][cg].getAttackBlack()) {
-                    insert(moves, Move(King, White, r1, ce, r1, cg, !EN_PASSANT, KingSide));
-                }
-            }
-            if (white.queenSide()) {
-                if (   board[r1][cb].isOpen()
-                   &&  board[r1][cc].isOpen()
-                   &&  board[r1][cd].isOpen()
-                   && !board[r1][cc].getAttackBlack()
-                   && !board[r1][cd].getAttackBlack()) {
-                    insert(moves, Move(King, White, r1, ce, r1, cc, !EN_PASSANT, QueenSide));
-                }
-            } 
-        } else {
 /*
     *----*----*----*----*----*----*----*----*
   8 | Rb |    |    |    | Kb |    |    | Rb |  8
+    *----*----*----*----*----*----*----*----*
+  1 | Rw |    |    |    | Kw |    |    | Rw |  1
     *----*----*----*----*----*----*----*----*
        a    b    c    d    e    f    g    h  
 */
-            if (blackCheck) { return; }
-            if (black.kingSide()) {
-                if (   board[r8][cf].isOpen() 
-                   &&  board[r8][cg].isOpen() 
-                   && !board[r8][cf].getAttackBlack()
-                   && !board[r8][cg].getAttackBlack()) {
-                    insert(moves, Move(King, Black, r8, ce, r8, cg, !EN_PASSANT, KingSide));
-                }
+    // the king may not be in check, the squares between king and rook must be
+    // open and the squares the king crosses may not be attacked
+    template <Side Us>
+    void moveCastle(Moves& moves) const
+    {
+        const Side Them = (Us == White) ? Black : White;
+        const Row r = (Us == White) ? r1 : r8;
+        const Castle& rights = castleRights(Us);
+        const Bitboard occ = occupied();
+        if (rights.kingSide()) {
+            const Bitboard path = squareBB(squareOf(r, cf)) | squareBB(squareOf(r, cg));
+            if (!(occ & path) && !isAttacked(squareOf(r, cf), Them) && !isAttacked(squareOf(r, cg), Them)) {
+                moves.insert(Move(r, ce, r, cg, Move::Castling));
             }
-            if (black.queenSide()) {
-                if (   board[r8][cb].isOpen()
-                   &&  board[r8][cc].isOpen()
-                   &&  board[r8][cd].isOpen()
-                   && !board[r8][cc].getAttackBlack()
-                   && !board[r8][cd].getAttackBlack()) {
-                    insert(moves, Move(King, Black, r8, ce, r8, cc, !EN_PASSANT, QueenSide));
-                }
+        }
+        if (rights.queenSide()) {
+            const Bitboard path = squareBB(squareOf(r, cc)) | squareBB(squareOf(r, cd));
+            if (!(occ & (path | squareBB(squareOf(r, cb)))) &&
+                !isAttacked(squareOf(r, cd), Them) && !isAttacked(squareOf(r, cc), Them)) {
+                moves.insert(Move(r, ce, r, cc, Move::Castling));
             }
         }
     }
 
-    // move in the North direction r1 -> r8
-    void moveN(const Move& piece, Moves& moves, Moves& attacks, int dist) const
+    // set up the position from a FEN string, if it does not parse the
+    // board is left empty and false is returned
+    bool fromFEN(const char *fen)
     {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(++_rT, _cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
-            }
+        clearBoard();
+        if (!parseFEN(fen)) {
+            clearBoard();
+            return false;
         }
+        return true;
     }
 
-    // move in the NorthEast direction r1 -> r8, ca -> ch
-    void moveNE(const Move& piece, Moves& moves, Moves& attacks, int dist) const
+    void toFEN(std::string& str) const
     {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(++_rT, ++_cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
+        str.clear();
+        for (int r = r8; r >= r1; --r) {
+            int open = 0;
+            for (int c = ca; c <= ch; ++c) {
+                const int sq = squareOf(r, c);
+                if (pieceOn(sq) == Empty) {
+                    ++open;
+                    continue;
+                }
+                if (open) { str += (char)('0' + open); }
+                open = 0;
+                str += fenPiece(pieceOn(sq), sideOn(sq));
             }
+            if (open) { str += (char)('0' + open); }
+            if (r != r1) { str += '/'; }
+        }
+        str += (turn == Black) ? " b " : " w ";
+        if (white.kingSide()) { str += 'K'; }
+        if (white.queenSide()) { str += 'Q'; }
+        if (black.kingSide()) { str += 'k'; }
+        if (black.queenSide()) { str += 'q'; }
+        if (!white.castle() && !black.castle()) { str += '-'; }
+        str += ' ';
+        if (epSquare == NoSquare) {
+            str += '-';
+        } else {
+            str += (char)('a' + colOf(epSquare));
+            str += (char)('1' + rowOf(epSquare));
         }
+        char buf[32];
+        snprintf(buf, sizeof(buf), " %d %d", halfmoveClock, fullmoveNumber);
+        str += buf;
     }
 
-    // move in the East direction ca -> ch
-    void moveE(const Move& piece, Moves& moves, Moves& attacks, int dist) const
+    static char fenPiece(Piece piece, Side side)
     {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(_rT, ++_cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
-            }
-        }
+        const char *letters = " prnbqk";
+        const char c = letters[piece];
+        return (side == White) ? (char)(c - 'a' + 'A') : c;
     }
 
-    // move in the South direction r8 -> r1, ca -> ch
-    void moveSE(const Move& piece, Moves& moves, Moves& attacks, int dist) const
+    static bool fenPiece(char c, Piece& piece, Side& side)
     {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(--_rT, ++_cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
-            }
-        }
+        const char *letters = "prnbqk";
+        const char *found = strchr(letters, (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+        if ((c == 0) || (found == NULL)) { return false; }
+        piece = (Piece)(Pawn + (found - letters));
+        side = (c >= 'A' && c <= 'Z') ? White : Black;
+        return true;
     }
 
-    // move in the South direction r8 -> r1
-    void moveS(const Move& piece, Moves& moves, Moves& attacks, int dist) const
+    static const char *skipSpaces(const char *p)
     {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(--_rT, _cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
-            }
-        }
+        while (*p == ' ') { ++p; }
+        return p;
     }
 
-    // move in the SouthWest direction r8 -> r1, ch -> ca
-    void moveSW(const Move& piece, Moves& moves, Moves& attacks, int dist) const
+    bool parseFEN(const char *p)
     {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(--_rT, --_cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
+        // pieces from rank 8 down to rank 1
+        int r = r8;
+        int c = ca;
+        for (p = skipSpaces(p); *p && (*p != ' '); ++p) {
+            Piece piece; Side side;
+            if (*p == '/') {
+                if ((c != cMax) || (r == r1)) { return false; }
+                --r;
+                c = ca;
+            } else if ((*p >= '1') && (*p <= '8')) {
+                c += *p - '0';
+                if (c > cMax) { return false; }
+            } else if (fenPiece(*p, piece, side) && (c < cMax)) {
+                putPiece(squareOf(r, c), piece, side);
+                ++c;
+            } else {
+                return false;
             }
         }
-    }
-
-    // move in the West direction ch -> ca
-    void moveW(const Move& piece, Moves& moves, Moves& attacks, int dist) const
-    {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(_rT, --_cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
+        if ((r != r1) || (c != cMax)) { return false; }
+        if ((popCount(pieces(White, King)) != 1) || (popCount(pieces(Black, King)) != 1)) { return false; }
+        // side to move
+        p = skipSpaces(p);
+        if (*p == 'w') {
+            turn = White;
+        } else if (*p == 'b') {
+            turn = Black;
+        } else {
+            return false;
+        }
+        // castling rights, only kept if the king and rook are still at home
+        p = skipSpaces(p + 1);
+        const char *letters = "KQkq";
+        bool rights[4] = { false, false, false, false };
+        for (; *p && (*p != ' '); ++p) {
+            const char *found = strchr(letters, *p);
+            if (found) {
+                rights[found - letters] = true;
+            } else if (*p != '-') {
+                return false;
             }
         }
-    }
-
-    // move in the NorthWest direction r1 -> r8, ch -> ca
-    void moveNW(const Move& piece, Moves& moves, Moves& attacks, int dist) const
-    {
-        Row rF = piece.rowF(); Col cF = piece.colF();
-        int _rT = rF; int _cT = cF;
-        while (!offBoard(++_rT, --_cT) && (--dist >= 0)) {
-            Row rT = (Row)_rT; Col cT = (Col)_cT;
-            if (!addMove(piece, moves, attacks, rF, cF, rT, cT)) {
-                return;
+        white.set(rights[0] && castleHome(White, ch), rights[1] && castleHome(White, ca));
+        black.set(rights[2] && castleHome(Black, ch), rights[3] && castleHome(Black, ca));
+        // en passant square, behind an enemy pawn that just moved two squares
+        // on the rank for the side to move, kept only if a pawn can take there
+        p = skipSpaces(p);
+        if ((*p >= 'a') && (*p <= 'h') && (p[1] == ((turn == White) ? '6' : '3'))) {
+            const int sq = squareOf(p[1] - '1', *p - 'a');
+            const int ahead = (turn == White) ? -8 : 8;
+            if ((pieceOn(sq + ahead) != Pawn) || (sideOn(sq + ahead) != opponent(turn)) ||
+                (pieceOn(sq) != Empty) || (pieceOn(sq - ahead) != Empty)) {
+                return false;
+            }
+            if (pawnAttacks(sideIndex(opponent(turn)), sq) & pieces(turn, Pawn)) {
+                epSquare = sq;
             }
+            p += 2;
+        } else if (*p == '-') {
+            ++p;
+        } else {
+            return false;
+        }
+        // the move counters are optional
+        p = skipSpaces(p);
+        if (*p) {
+            char *end;
+            halfmoveClock = (int)strtol(p, &end, 10);
+            p = skipSpaces(end);
+            if (*p) {
+                fullmoveNumber = (int)strtol(p, &end, 10);
+                p = skipSpaces(end);
+            }
+            if (*p || (halfmoveClock < 0) || (fullmoveNumber < 1)) { return false; }
         }
+        key = computeKey();
+        setAttacks();
+        // the side that just moved cannot have left its king in check
+        if (inCheck(opponent(turn))) { return false; }
+        whiteCheck = (turn == White) && inCheck(White);
+        blackCheck = (turn == Black) && inCheck(Black);
+        return true;
     }
 
-    bool canMove(const Move& piece, Row rT, Col cT, bool& more) const
-    {
-        if (isOpen(rT, cT)) { more = true; return true; }
-        if (  (piece.isWhite() && isBlack(rT, cT)) 
-           || (piece.isBlack() && isWhite(rT, cT))) {
-            more = false;
-            return true;
+    // king and rook on the squares they castle from
+    bool castleHome(Side side, Col rookCol) const
+    {
+        const Row r = (side == White) ? r1 : r8;
+        return (pieces(side, King) & squareBB(squareOf(r, ce))) &&
+               (pieces(side, Rook) & squareBB(squareOf(r, rookCol)));
+    }
+
+    void toSnapshot(Snapshot& snapshot) const
+    {
+        memcpy(snapshot.pieces, pieceBB, sizeof(snapshot.pieces));
+        snapshot.key = key;
+        snapshot.midgame = (int16_t)midgame;
+        snapshot.endgame = (int16_t)endgame;
+        snapshot.phase = (uint8_t)phase;
+        snapshot.check = inCheck(turn);
+        snapshot.fullmoveNumber = (uint16_t)fullmoveNumber;
+        snapshot.halfmoveClock = (uint8_t)((halfmoveClock < 255) ? halfmoveClock : 255);
+        snapshot.turn = (uint8_t)turn;
+        snapshot.castle = (uint8_t)(white.rights() | (black.rights() << 2));
+        snapshot.epSquare = (uint8_t)epSquare;
+    }
+
+    // take the position from a snapshot, the game record, captured pieces
+    // and the positions before it for repetitions start out empty, nothing
+    // is worked out again past the mailbox, so the attack counts are not
+    // set, call setAttacks() before play() or move()
+    void fromSnapshot(const Snapshot& snapshot)
+    {
+        memcpy(pieceBB, snapshot.pieces, sizeof(pieceBB));
+        memset(mailbox, 0, sizeof(mailbox));
+        for (int s = 0; s < 2; ++s) {
+            sideBB[s] = 0;
+            for (int p = 0; p < 6; ++p) {
+                Bitboard bb = pieceBB[s][p];
+                sideBB[s] |= bb;
+                while (bb) {
+                    mailbox[popLsb(bb)] = (unsigned char)((Pawn + p) | ((s ? Black : White) << 3));
+                }
+            }
         }
-        return false;
+        key = snapshot.key;
+        midgame = snapshot.midgame;
+        endgame = snapshot.endgame;
+        phase = snapshot.phase;
+        fullmoveNumber = snapshot.fullmoveNumber;
+        halfmoveClock = snapshot.halfmoveClock;
+        turn = (Turn)snapshot.turn;
+        white.set((snapshot.castle & 1) != 0, (snapshot.castle & 2) != 0);
+        black.set((snapshot.castle & 4) != 0, (snapshot.castle & 8) != 0);
+        epSquare = snapshot.epSquare;
+        plies = 0;
+        drawReason = NoDraw;
+        promotion = false;
+        castle = false;
+        enpassant = false;
+        whiteCheck = (turn == White) && snapshot.check;
+        blackCheck = (turn == Black) && snapshot.check;
+        clearHistory();
+    }
+
+    // an empty board with white to move
+    void clearBoard()
+    {
+        init(false);
+        turn = White;
+        white.set(false, false);
+        black.set(false, false);
+        epSquare = NoSquare;
+        halfmoveClock = 0;
+        fullmoveNumber = 1;
+        plies = 0;
+        drawReason = NoDraw;
+        whiteCheck = false;
+        blackCheck = false;
+        promotion = false;
+        castle = false;
+        enpassant = false;
+        clearHistory();
+        key = computeKey();
     }
 
-    bool addMove(const Move& piece, Moves& moves, Moves& attacks, Row rF, Col cF, Row rT, Col cT) const
+    // forget the game record and captured pieces but keep the position,
+    // copies of the board are then cheap to make
+    void clearHistory()
     {
-        // can always attack
-        insert(attacks, Move(piece.getPiece(), piece.getSide(), rF, cF, rT, cT));
-        bool more;
-        if (canMove(piece, rT, cT, more)) {
-            // can move also
-            insert(moves, Move(piece.getPiece(), piece.getSide(), rF, cF, rT, cT));
-            return more;
-        }
-        return false;
+        whiteCapturedPieces.clear();
+        blackCapturedPieces.clear();
+        movesCheck.clear();
+        gameMoves.clear();
     }
 
     void init(bool pieces)
     {
-        initSquares();
+        memset(pieceBB, 0, sizeof(pieceBB));
+        memset(sideBB, 0, sizeof(sideBB));
+        memset(mailbox, 0, sizeof(mailbox));
+        midgame = 0;
+        endgame = 0;
+        phase = 0;
         if (pieces) {
             initPieces();
         }
-    }
-
-    void initSquares()
-    {
-        for (int r = r1; r <= r8; ++r) {
-            Color _color = ((r % 2) == 0) ? Dark : Light;
-            for (int c = ca; c <= ch; ++c) {
-                board[r][c].setSquare(_color, (Row)r, (Col)c);
-                _color = (_color == Light) ? Dark : Light;
-            }
-        }
+        setAttacks();
+        key = computeKey();
     }
 
     void initPieces()
@@ -1138,54 +1674,68 @@ public:
     void initPawns(Row r, Side side)
     {
         for (int c = ca; c <= ch; ++c) {
-            setBoardPiece(r, (Col)c, Pawn, side, true);
+            setBoardPiece(r, (Col)c, Pawn, side);
         }
     }
 
     void initOther(Row r, Side side)
     {
-        setBoardPiece(r, ca, Rook, side, true);
-        setBoardPiece(r, cb, Knight, side, true);
-        setBoardPiece(r, cc, Bishop, side, true);
-        setBoardPiece(r, cd, Queen, side, true);
-        setBoardPiece(r, ce, King, side, true);
-        setBoardPiece(r, cf, Bishop, side, true);
-        setBoardPiece(r, cg, Knight, side, true);
-        setBoardPiece(r, ch, Rook, side, true);
+        setBoardPiece(r, ca, Rook, side);
+        setBoardPiece(r, cb, Knight, side);
+        setBoardPiece(r, cc, Bishop, side);
+        setBoardPiece(r, cd, Queen, side);
+        setBoardPiece(r, ce, King, side);
+        setBoardPiece(r, cf, Bishop, side);
+        setBoardPiece(r, cg, Knight, side);
+        setBoardPiece(r, ch, Rook, side);
     }
 
-    void setBoardPiece(Row r, Col c, Piece piece, Side side, bool addSide = false)
+    void setBoardPiece(Row r, Col c, Piece piece, Side side)
     {
         if ((side == None) || (piece == Empty)) { return; }
-        board[r][c].setPiece(piece, side);
-        if (addSide) {
-            setSidePiece(r, c, piece, side);
-        }
+        const int sq = squareOf(r, c);
+        removePiece(sq);
+        putPiece(sq, piece, side);
     }
 
-    void setSidePiece(Row r, Col c, Piece piece, Side side)
+    void putPiece(int sq, Piece piece, Side side)
     {
-        if ((side == None) || (piece == Empty)) { return; }
-        Pieces& pieces = (side == White) ? whitePieces : blackPieces;
-        insert(pieces, Move(piece, side, r, c, r, c));
+        const Bitboard bb = squareBB(sq);
+        pieceBB[sideIndex(side)][piece - Pawn] |= bb;
+        sideBB[sideIndex(side)] |= bb;
+        mailbox[sq] = (unsigned char)(piece | (side << 3));
+        key ^= pieceKey(sq, piece, side);
+        addScore(sq, piece, side, 1);
     }
 
-    void updSidePiece(Row rF, Col cF, Row rT, Col cT, Piece piece, Side side)
+    void removePiece(int sq)
     {
-        if ((side == None) || (piece == Empty)) { return; }
-        Pieces& pieces = (side == White) ? whitePieces : blackPieces;
-        update(pieces, Move(piece, side, rF, cF, rF, cF), Move(promote(piece, side, rT), side, rT, cT, rT, cT));
+        const Piece piece = pieceOn(sq);
+        if (piece == Empty) { return; }
+        const Side side = sideOn(sq);
+        const Bitboard bb = squareBB(sq);
+        pieceBB[sideIndex(side)][piece - Pawn] &= ~bb;
+        sideBB[sideIndex(side)] &= ~bb;
+        mailbox[sq] = 0;
+        key ^= pieceKey(sq, piece, side);
+        addScore(sq, piece, side, -1);
+    }
+
+    // add or take away a piece from the running scores, white is positive
+    void addScore(int sq, Piece piece, Side side, int sign)
+    {
+        const PieceScore& score = Scores::score[sideIndex(side)][piece - Pawn][sq];
+        midgame += sign * score.midgame;
+        endgame += sign * score.endgame;
+        phase += sign * score.phase;
     }
 
     void remSidePiece(Row r, Col c, Piece piece, Side side)
     {
         if ((side == None) || (piece == Empty)) { return; }
-        Pieces& pieces = (side == White) ? whitePieces : blackPieces;
         Pieces& captured = (side == White) ? whiteCapturedPieces : blackCapturedPieces;
-        remove(pieces, Move(piece, side, r, c, r, c));
-        insert(captured, Move(piece, side, r, c, r, c));
+        captured.insert(Square((((r + c) % 2) == 0) ? Dark : Light, r, c, piece, side, 0, 0));
     }
-
     bool firstPawnMove(Row r, Side s) const
     {
         if (r == r2 && s == White) {
@@ -1197,58 +1747,137 @@ public:
         }
     }
 
-    Piece promote(Piece piece, Side side, Row rT) const
-    {
-        bool yes = (  (piece == Pawn)
-                   && (  ((side == White) && (rT == r8))
-                      || ((side == Black) && (rT == r1))));
-        return yes ? Queen : piece;
-    }
-
-    const Pieces& getMovesCheck() const { return movesCheck; }
+    const Moves& getMovesCheck() const { return movesCheck; }
 
     bool isValidRow(int r) const { return (r >= r1) && (r <= r8); }
     bool isValidCol(int c) const { return (c >= ca) && (c <= ch); }
 
     bool hasMoves() const { return !gameMoves.empty(); }
 
-    bool lastMoveCanEnpassant(Row rF, Col cF, Side side, Row& rT, Col& cT) const
-    {
-        // only white pawns on the 5th rank can en passant
-        if ((side == White) && (rF != r5)) { return false; }
-        // only black pawns on the 4th rank can en passant
-        if ((side == Black) && (rF != r4)) { return false; }
-        if (!hasMoves()) { return false; }
-        const Move& lastMove = *gameMoves.rbegin();
-        if (!lastMove.wasFirstPawnDoubleMove()) { return false; }
-        if (rF != lastMove.rowT()) { return false; }
-        if (  (cF == (lastMove.colT() - 1))
-           || (cF == (lastMove.colT() + 1))) {
-            rT = (side == White) ? r6 : r3;
-            cT = lastMove.colT();
-            return true;
+    // the move with the piece that makes it and the piece it takes on this board
+    MoveInfo moveInfo(const Move& move) const
+    {
+        const int to = move.isEnpassant() ? squareOf(move.rowF(), move.colT()) : move.to();
+        return MoveInfo(move, pieceOn(move.from()), sideOn(move.from()), pieceOn(to));
+    }
+
+    // the square a pawn passed over moving two squares on the last move,
+    // NoSquare unless a pawn of the side on turn can take it en passant
+    int enpassantSquare() const { return epSquare; }
+
+    // the hash of this position, kept up to date by every change to the board
+    uint64_t getKey() const { return key; }
+
+    // material and piece square score for the side to move in centipawns,
+    // the midgame and endgame scores blended by how much material is left
+    int evaluate() const
+    {
+        const int ph = (phase < MaxPhase) ? phase : MaxPhase;
+        const int score = (midgame * ph + endgame * (MaxPhase - ph)) / MaxPhase;
+        return (turn == White) ? score : -score;
+    }
+
+    // the evaluation for the side to move once it has made move, worked out
+    // from the score tables without making it
+    int evaluateAfter(const Move& move) const
+    {
+        const int us = sideIndex(turn);
+        const int from = move.from();
+        const int to = move.to();
+        const Piece piece = pieceOn(from);
+        PieceScore total = { midgame, endgame, phase };
+        addScore(total, Scores::score[us][piece - Pawn][from], -1);
+        addScore(total, Scores::score[us][(move.isPromotion() ? move.getPromotion() : piece) - Pawn][to], 1);
+        if (move.isEnpassant()) {
+            addScore(total, Scores::score[us ^ 1][0][squareOf(rowOf(from), colOf(to))], -1);
+        } else if (pieceOn(to) != Empty) {
+            addScore(total, Scores::score[us ^ 1][pieceOn(to) - Pawn][to], -1);
         }
-        return false;
+        if (move.isCastle()) {
+            const int r = rowOf(from);
+            addScore(total, Scores::score[us][Rook - Pawn][squareOf(r, move.isKingSide() ? ch : ca)], -1);
+            addScore(total, Scores::score[us][Rook - Pawn][squareOf(r, move.isKingSide() ? cf : cd)], 1);
+        }
+        const int ph = (total.phase < MaxPhase) ? total.phase : MaxPhase;
+        const int score = (total.midgame * ph + total.endgame * (MaxPhase - ph)) / MaxPhase;
+        return (turn == White) ? score : -score;
+    }
+
+    static void addScore(PieceScore& total, const PieceScore& score, int sign)
+    {
+        total.midgame += sign * score.midgame;
+        total.endgame += sign * score.endgame;
+        total.phase += sign * score.phase;
+    }
+
+    // the running scores from white's side and the phase, MaxPhase or more
+    // with all the pieces on the board and 0 with only kings and pawns
+    int getMidgame() const { return midgame; }
+    int getEndgame() const { return endgame; }
+    int getPhase() const { return phase; }
+
+    // the scores worked out from scratch, they always match the running ones
+    void computeScore(int& mg, int& eg, int& ph) const
+    {
+        mg = 0;
+        eg = 0;
+        ph = 0;
+        for (int s = 0; s < 2; ++s) {
+            for (int p = 0; p < 6; ++p) {
+                Bitboard bb = pieceBB[s][p];
+                while (bb) {
+                    const PieceScore& score = Scores::score[s][p][popLsb(bb)];
+                    mg += score.midgame;
+                    eg += score.endgame;
+                    ph += score.phase;
+                }
+            }
+        }
+    }
+
+    // the hash of this position worked out from scratch, it always matches getKey
+    uint64_t computeKey() const
+    {
+        uint64_t k = 0;
+        Bitboard bb = occupied();
+        while (bb) {
+            const int sq = popLsb(bb);
+            k ^= pieceKey(sq, pieceOn(sq), sideOn(sq));
+        }
+        k ^= castleKey() ^ enpassantKey();
+        if (turn == Black) {
+            k ^= Zobrist::get().turn;
+        }
+        return k;
+    }
+
+    uint64_t pieceKey(int sq, Piece piece, Side side) const
+    {
+        return Zobrist::get().pieces[sideIndex(side)][piece - Pawn][sq];
     }
 
+    uint64_t castleKey() const { return Zobrist::get().castle[white.rights() | (black.rights() << 2)]; }
+    uint64_t enpassantKey() const { return (epSquare == NoSquare) ? 0 : Zobrist::get().enpassant[colOf(epSquare)]; }
+
     void toStringAttacks(Side side, std::string& str) const
     {
         str.clear();
         str += "       a    b    c    d    e    f    g    h  \n";
         str += "    *----*----*----*----*----*----*----*----*\n";
+        const unsigned char *counts = attackCount[sideIndex(side)];
         for (int r = r8; r >= r1; --r) {
             char buf[256];
             const char *fmt = " %2d | %2d | %2d | %2d | %2d | %2d | %2d | %2d | %2d | %2d\n";
             snprintf(buf, sizeof(buf), fmt,
                      r + 1,
-                     (side == White) ? board[r][ca].getAttackWhite() : board[r][ca].getAttackBlack(),
-                     (side == White) ? board[r][cb].getAttackWhite() : board[r][cb].getAttackBlack(),
-                     (side == White) ? board[r][cc].getAttackWhite() : board[r][cc].getAttackBlack(),
-                     (side == White) ? board[r][cd].getAttackWhite() : board[r][cd].getAttackBlack(),
-                     (side == White) ? board[r][ce].getAttackWhite() : board[r][ce].getAttackBlack(),
-                     (side == White) ? board[r][cf].getAttackWhite() : board[r][cf].getAttackBlack(),
-                     (side == White) ? board[r][cg].getAttackWhite() : board[r][cg].getAttackBlack(),
-                     (side == White) ? board[r][ch].getAttackWhite() : board[r][ch].getAttackBlack(),
+                     counts[squareOf(r, ca)],
+                     counts[squareOf(r, cb)],
+                     counts[squareOf(r, cc)],
+                     counts[squareOf(r, cd)],
+                     counts[squareOf(r, ce)],
+                     counts[squareOf(r, cf)],
+                     counts[squareOf(r, cg)],
+                     counts[squareOf(r, ch)],
                      r + 1);
             str += buf;
             str += "    *----*----*----*----*----*----*----*----*\n";
@@ -1266,14 +1895,14 @@ public:
             const char *fmt = " %2d |%s|%s|%s|%s|%s|%s|%s|%s| %2d\n";
             snprintf(buf, sizeof(buf), fmt,
                      r + 1,
-                     board[r][ca].toString(),
-                     board[r][cb].toString(),
-                     board[r][cc].toString(),
-                     board[r][cd].toString(),
-                     board[r][ce].toString(),
-                     board[r][cf].toString(),
-                     board[r][cg].toString(),
-                     board[r][ch].toString(),
+                     squareString(r, ca),
+                     squareString(r, cb),
+                     squareString(r, cc),
+                     squareString(r, cd),
+                     squareString(r, ce),
+                     squareString(r, cf),
+                     squareString(r, cg),
+                     squareString(r, ch),
                      r + 1);
             str += buf;
             str += "    *----*----*----*----*----*----*----*----*\n";
@@ -1281,6 +1910,12 @@ public:
         str += "       a    b    c    d    e    f    g    h  \n";
     }
 
+    const char *squareString(int r, int c) const
+    {
+        const int sq = squareOf(r, c);
+        return Square::toString(pieceOn(sq), sideOn(sq));
+    }
+
     void toString(const Moves& moves, std::string& str) const
     {
         str.clear();
@@ -1312,7 +1947,7 @@ public:
 
     void whitePiecesStr(std::string& str) const
     {
-        sidePiecesStr(whitePieces, str);
+        sidePiecesStr(White, str);
     }
 
     void whiteCapturedPiecesStr(std::string& str) const
@@ -1322,7 +1957,7 @@ public:
 
     void blackPiecesStr(std::string& str) const
     {
-        sidePiecesStr(blackPieces, str);
+        sidePiecesStr(Black, str);
     }
 
     void blackCapturedPiecesStr(std::string& str) const
@@ -1330,79 +1965,47 @@ public:
         sidePiecesStr(blackCapturedPieces, str);
     }
 
-    void insert(Moves& pieces, const Move& piece) const
+    void sidePiecesStr(Side side, std::string& str) const
     {
-        pieces.insert(piece);
-    }
-
-    void update(Moves& pieces, const Move& from, const Move& to)
-    {
-        remove(pieces, from);
-        if (from.getPiece() != to.getPiece()) {
-            // piece was promoted
-            setBoardPiece(to.rowT(), to.colT(), to.getPiece(), to.getSide());
-            promotion = true;
+        str.clear();
+        bool first = true;
+        Bitboard bb = occupied(side);
+        while (bb) {
+            const int sq = popLsb(bb);
+            if (!first) { str += ","; }
+            first = false;
+            str += Square::toString(pieceOn(sq), side);
+            str += Square::toString((Col)colOf(sq));
+            str += Square::toString((Row)rowOf(sq));
         }
-        insert(pieces, to);
     }
 
-    void remove(Moves& pieces, const Move& piece) const
-    {
-        pieces.erase(piece);
-    }
-
-    void sidePiecesStr(const Moves& pieces, std::string& str) const
+    void sidePiecesStr(const Pieces& pieces, std::string& str) const
     {
         str.clear();
         bool first = true;
-        MovesCItr itr = pieces.begin();
+        PiecesCItr itr = pieces.begin();
         for (; itr != pieces.end(); ++itr) {
             if (!first) { str += ","; }
             first = false;
-            std::string tmp;
-            (*itr).toStringPiece(tmp);
-            str += tmp;
+            str += (*itr).toString();
+            str += Square::toString((*itr).getCol());
+            str += Square::toString((*itr).getRow());
         }
     }
 
-    void setAttacks(const Moves& attacks, Side side)
+    // count the attacks of both sides on every square from scratch, play()
+    // keeps them up to date after that, a position changed any other way
+    // (setBoardPiece, makeMove, playout, fromSnapshot) needs to call this again
+    void setAttacks()
     {
-        MovesCItr itr = attacks.begin();
-        for (; itr != attacks.end(); ++itr) {
-            const Move& move = *itr;
-            Row r = move.rowT();
-            Col c = move.colT();
-            if (side == White) {
-                // see if white is attacking the black king
-                if ((board[r][c].getSide() == Black) && (board[r][c].getPiece() == King)) {
-                    checkAttacker = &move;
-                    blackCheck = true;
-                }
-                board[r][c].incrAttackWhite();
-            } else {
-                // see if black is attacking the white king
-                if ((board[r][c].getSide() == White) && (board[r][c].getPiece() == King)) {
-                    checkAttacker = &move;
-                    whiteCheck = true;
-                }
-                board[r][c].incrAttackBlack();
-            }
-        }
+        clearAttacks();
+        countAttacks(occupied(), 1);
     }
 
     void clearAttacks()
     {
-        checkAttacker = NULL;
-        whiteCheck = false;
-        blackCheck = false;
-        for (int r = r1; r <= r8; ++r) {
-            for (int c = ca; c <= ch; ++c) {
-                board[r][c].clearAttacks();
-            }
-        }
-        promotion = false;
-        castle = false;
-        enpassant = false;
+        memset(attackCount, 0, sizeof(attackCount));
     }
 
     bool getCheck(Side player) const
@@ -1414,24 +2017,47 @@ public:
     bool wasCastle() const { return castle; }
     bool wasEnpassant() const { return enpassant; }
 
+    static int sideIndex(Side side) { return (side == Black) ? 1 : 0; }
+    static Side opponent(Side side) { return (side == White) ? Black : White; }
+
 private:
-    const bool EN_PASSANT;
-    unsigned seed;
+    Random rng;
     Turn turn;
-    Square board[rMax][cMax];
+    // one bitboard per side and piece, Pawn through King
+    Bitboard pieceBB[2][6];
+    // all pieces of each side
+    Bitboard sideBB[2];
+    // piece | (side << 3) on each square, for constant time lookups
+    unsigned char mailbox[64];
+    // number of pieces of each side attacking a square
+    unsigned char attackCount[2][64];
     Castle white;
     Castle black;
-    const Move *checkAttacker;
+    // square behind a pawn that just moved two squares, or NoSquare
+    int epSquare;
+    int halfmoveClock;
+    int fullmoveNumber;
+    // zobrist hash of the pieces, turn, castling rights and en passant file
+    uint64_t key;
+    // material and piece square totals for white less those for black, and
+    // the phase, kept up to date as pieces are put down and taken off
+    int midgame;
+    int endgame;
+    int phase;
     bool whiteCheck;
     bool blackCheck;
     bool promotion;
     bool castle;
     bool enpassant;
-    Pieces whitePieces;
+    DrawReason drawReason;
+    // keys of the positions before each move made, a ring of the last
+    // KeyHistory, enough to find repetitions inside the fifty move limit
+    static const int KeyHistory = 128;
+    uint64_t keyHistory[KeyHistory];
+    unsigned plies;
     Pieces whiteCapturedPieces;
-    Pieces blackPieces;
     Pieces blackCapturedPieces;
-    Pieces movesCheck;
+    Moves movesCheck;
     std::list<Move> gameMoves;
 };
 
@@ -0,0 +1,329 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef Mcts_hpp
+#define Mcts_hpp
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Chess.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// a node of the tree, the children of a node sit next to each other in the pool,
+// all threads of a search read and update the same nodes
+struct MctsNode
+{
+    // firstChild of a node that has not been expanded
+    static const uint32_t NotExpanded = 0;
+    // firstChild while one thread fills in the children
+    static const uint32_t Expanding = 0xFFFFFFFE;
+    // firstChild of an expanded node with no legal moves
+    static const uint32_t NoChildren = 0xFFFFFFFF;
+
+    MctsNode()
+    {
+        reset(Move());
+    }
+
+    void reset(const Move& _move)
+    {
+        move = _move;
+        numChildren = 0;
+        firstChild.store(NotExpanded, std::memory_order_relaxed);
+        visits.store(0, std::memory_order_relaxed);
+        wins.store(0, std::memory_order_relaxed);
+    }
+
+    // the move that leads here from the parent
+    Move move;
+    // written before firstChild is published
+    uint16_t numChildren;
+    std::atomic<uint32_t> firstChild;
+    // visits are counted on the way down, so a thread still in a playout
+    // counts as a loss for the others until its result comes back
+    std::atomic<uint32_t> visits;
+    // playout score in half points for the side that played move,
+    // 2 for a win and 1 for a draw
+    std::atomic<uint32_t> wins;
+};
+
+// a root move and how much the search looked at it
+struct RootMove
+{
+    Move move;
+    unsigned visits;
+    // average score for the side to move at the root
+    float value;
+};
+
+typedef FixedList<RootMove, MaxMoves> RootMoves;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// UCT Monte Carlo Tree Search, the tree lives in a pool of maxNodes nodes
+// allocated once, a search stops when the pool is full, after maxIterations
+// playouts or after maxMillis milliseconds, whichever comes first
+//
+// with more than one thread all of them search the one tree, statistics are
+// atomic, virtual loss spreads the threads over different branches and a
+// leaf is claimed for expansion with a compare and swap
+class Mcts
+{
+public:
+    Mcts(unsigned maxNodes = 1 << 20, uint64_t seed = 0)
+        : exploration(1.4f)
+        , maxPlies(200)
+        , expandVisits(1)
+        , virtualLoss(1)
+        , rng(seed)
+        , pool(new MctsNode[maxNodes])
+        , poolSize(maxNodes)
+        , numNodes(0)
+        , numIterations(0)
+        , stop(false)
+    {
+    }
+
+    // UCT exploration constant
+    void setExploration(float c) { exploration = c; }
+    // playouts that run longer than this count as a draw
+    void setMaxPlies(int plies) { maxPlies = plies; }
+    // a leaf is expanded once it has been visited this many times
+    void setExpandVisits(unsigned visits) { expandVisits = visits; }
+    // visits added on the way down and taken back with the result
+    void setVirtualLoss(unsigned visits) { virtualLoss = (visits > 0) ? visits : 1; }
+
+    void search(const Board& board, unsigned long maxIterations, unsigned long maxMillis = 0,
+                unsigned numThreads = 1)
+    {
+        search(board, maxIterations, maxMillis, numThreads, RandomPolicy());
+    }
+
+    // playouts pick their moves with policy, see Policy.hpp
+    template <typename Policy>
+    void search(const Board& board, unsigned long maxIterations, unsigned long maxMillis,
+                unsigned numThreads, Policy policy)
+    {
+        start = std::chrono::steady_clock::now();
+        board.toSnapshot(root);
+        numNodes.store(1);
+        numIterations.store(0);
+        stop.store(false);
+        pool[0].reset(Move());
+        if (!expand(0, Board(root)) || !hasChildren(pool[0].firstChild.load())) { return; }
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < numThreads; ++t) {
+            threads.push_back(std::thread(&Mcts::run<Policy>, this, rng.next(), maxIterations, maxMillis,
+                                          policy));
+        }
+        run(rng.next(), maxIterations, maxMillis, policy);
+        for (unsigned t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+        }
+    }
+
+    // visit counts and values of the root moves
+    void rootMoves(RootMoves& moves) const
+    {
+        moves.clear();
+        const MctsNode& node = pool[0];
+        const uint32_t first = node.firstChild.load();
+        if (!hasChildren(first)) { return; }
+        for (unsigned i = 0; i < node.numChildren; ++i) {
+            const MctsNode& child = pool[first + i];
+            RootMove rootMove;
+            rootMove.move = child.move;
+            rootMove.visits = child.visits.load();
+            rootMove.value = rootMove.visits ? child.wins.load() * 0.5f / rootMove.visits : 0;
+            moves.insert(rootMove);
+        }
+    }
+
+    // the most visited root move, false if the root has no moves
+    bool bestMove(Move& move) const
+    {
+        const MctsNode& node = pool[0];
+        const uint32_t first = node.firstChild.load();
+        if (!hasChildren(first)) { return false; }
+        const MctsNode *best = &pool[first];
+        for (unsigned i = 1; i < node.numChildren; ++i) {
+            const MctsNode& child = pool[first + i];
+            if (child.visits.load() > best->visits.load()) { best = &child; }
+        }
+        move = best->move;
+        return true;
+    }
+
+    unsigned long iterations() const { return numIterations.load(); }
+    unsigned nodes() const { return (numNodes.load() < poolSize) ? numNodes.load() : poolSize; }
+    unsigned maxNodes() const { return poolSize; }
+
+private:
+    // one search thread, it stops all the others when a limit is reached
+    template <typename Policy>
+    void run(uint64_t seed, unsigned long maxIterations, unsigned long maxMillis, Policy policy)
+    {
+        Random random(seed);
+        unsigned long count = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (numIterations.fetch_add(1, std::memory_order_relaxed) >= maxIterations) {
+                numIterations.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            if (!iterate(random, policy)) {
+                numIterations.fetch_sub(1, std::memory_order_relaxed);
+                break;
+            }
+            // looking at the clock costs more than a playout, do it now and then
+            if (maxMillis && ((++count & 63) == 0) && (elapsedMillis() >= maxMillis)) {
+                break;
+            }
+        }
+        stop.store(true, std::memory_order_relaxed);
+    }
+
+    // select down to a leaf, expand it, play it out and back up the result
+    template <typename Policy>
+    bool iterate(Random& random, Policy& policy)
+    {
+        Board board(root);
+        uint32_t path[MaxDepth];
+        int depth = 0;
+        uint32_t idx = 0;
+        addVisit(idx, path, depth);
+        uint32_t first = pool[idx].firstChild.load(std::memory_order_acquire);
+        while (hasChildren(first) && (depth < MaxDepth)) {
+            idx = selectChild(pool[idx], first);
+            UndoInfo undo;
+            board.makeMove(pool[idx].move, undo);
+            addVisit(idx, path, depth);
+            first = pool[idx].firstChild.load(std::memory_order_acquire);
+        }
+        MctsNode& leaf = pool[idx];
+        // our own visit is already on the leaf, only one thread wins the claim
+        const uint32_t visits = leaf.visits.load(std::memory_order_relaxed);
+        if ((first == MctsNode::NotExpanded) && (visits >= expandVisits + virtualLoss) &&
+            leaf.firstChild.compare_exchange_strong(first, MctsNode::Expanding)) {
+            if (!expand(idx, board)) {
+                leaf.firstChild.store(MctsNode::NotExpanded);
+                undoVisits(path, depth);
+                return false;
+            }
+            first = leaf.firstChild.load(std::memory_order_relaxed);
+            if (hasChildren(first) && (depth < MaxDepth)) {
+                idx = first + random.below(leaf.numChildren);
+                UndoInfo undo;
+                board.makeMove(pool[idx].move, undo);
+                addVisit(idx, path, depth);
+            }
+        }
+        // the side that made the move into the leaf
+        const Side mover = Board::opponent(board.getTurn());
+        const Result result = board.playout(maxPlies, random, policy);
+        uint32_t score = 1;
+        if ((result == WhiteWin) || (result == BlackWin)) {
+            score = ((result == WhiteWin) == (mover == White)) ? 2 : 0;
+        }
+        // each ply up the path flips whose score it is, the virtual loss
+        // beyond the one real visit is taken back
+        for (int i = depth - 1; i >= 0; --i) {
+            MctsNode& node = pool[path[i]];
+            if (virtualLoss > 1) {
+                node.visits.fetch_sub(virtualLoss - 1, std::memory_order_relaxed);
+            }
+            if (score) {
+                node.wins.fetch_add(score, std::memory_order_relaxed);
+            }
+            score = 2 - score;
+        }
+        return true;
+    }
+
+    void addVisit(uint32_t idx, uint32_t *path, int& depth)
+    {
+        pool[idx].visits.fetch_add(virtualLoss, std::memory_order_relaxed);
+        path[depth++] = idx;
+    }
+
+    void undoVisits(const uint32_t *path, int depth)
+    {
+        for (int i = 0; i < depth; ++i) {
+            pool[path[i]].visits.fetch_sub(virtualLoss, std::memory_order_relaxed);
+        }
+    }
+
+    // add a child for every legal move, false if the pool is full, the
+    // caller owns the node by having set firstChild to Expanding
+    bool expand(uint32_t idx, const Board& board)
+    {
+        Moves moves;
+        board.legalMoves(board.getTurn(), moves);
+        if (moves.empty()) {
+            pool[idx].firstChild.store(MctsNode::NoChildren, std::memory_order_release);
+            return true;
+        }
+        const uint32_t first = numNodes.fetch_add(moves.size());
+        if (first + moves.size() > poolSize) { return false; }
+        for (unsigned i = 0; i < moves.size(); ++i) {
+            pool[first + i].reset(moves[i]);
+        }
+        pool[idx].numChildren = (uint16_t)moves.size();
+        pool[idx].firstChild.store(first, std::memory_order_release);
+        return true;
+    }
+
+    // the child with the best upper confidence bound, unvisited children first
+    uint32_t selectChild(const MctsNode& node, uint32_t first) const
+    {
+        const float logVisits = logf((float)node.visits.load(std::memory_order_relaxed) + 1);
+        uint32_t best = first;
+        float bestScore = -1;
+        for (unsigned i = 0; i < node.numChildren; ++i) {
+            const uint32_t idx = first + i;
+            const MctsNode& child = pool[idx];
+            const uint32_t visits = child.visits.load(std::memory_order_relaxed);
+            if (visits == 0) { return idx; }
+            const float score = child.wins.load(std::memory_order_relaxed) * 0.5f / visits +
+                                exploration * sqrtf(logVisits / visits);
+            if (score > bestScore) {
+                bestScore = score;
+                best = idx;
+            }
+        }
+        return best;
+    }
+
+    static bool hasChildren(uint32_t first)
+    {
+        return (first != MctsNode::NotExpanded) && (first != MctsNode::Expanding) &&
+               (first != MctsNode::NoChildren);
+    }
+
+    unsigned long elapsedMillis() const
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    // deepest path followed from the root
+    static const int MaxDepth = 256;
+
+    float exploration;
+    int maxPlies;
+    unsigned expandVisits;
+    unsigned virtualLoss;
+    Random rng;
+    Snapshot root;
+    std::unique_ptr<MctsNode[]> pool;
+    unsigned poolSize;
+    std::atomic<uint32_t> numNodes;
+    std::atomic<unsigned long> numIterations;
+    std::atomic<bool> stop;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef PieceSquare_hpp
+#define PieceSquare_hpp
+#include "Bitboard.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// piece values and square bonuses for the midgame and the endgame, indexed
+// by piece - Pawn, that is Pawn, Rook, Knight, Bishop, Queen, King
+//
+// PieceValues in Chess.hpp, used by static exchange, is built from MidgameMaterial
+//
+// the squares are laid out as seen by white, a8 first and h1 last, so a
+// white piece on sq looks up sq ^ 56 and a black piece looks up sq
+
+constexpr int MidgameMaterial[6] = { 100, 500, 320, 330, 900, 0 };
+constexpr int EndgameMaterial[6] = { 120, 550, 300, 320, 950, 0 };
+
+// how much each piece counts towards the midgame, all of them at the start
+// make MaxPhase and the score is all midgame, none make it all endgame
+constexpr int PhaseWeights[6] = { 0, 2, 1, 1, 4, 0 };
+constexpr int MaxPhase = 24;
+
+constexpr int MidgameSquares[6][64] = {
+    // Pawn
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+       50,  50,  50,  50,  50,  50,  50,  50,
+       10,  10,  20,  30,  30,  20,  10,  10,
+        5,   5,  10,  25,  25,  10,   5,   5,
+        0,   0,   0,  20,  20,   0,   0,   0,
+        5,  -5, -10,   0,   0, -10,  -5,   5,
+        5,  10,  10, -20, -20,  10,  10,   5,
+        0,   0,   0,   0,   0,   0,   0,   0 },
+    // Rook
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+        5,  10,  10,  10,  10,  10,  10,   5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+       -5,   0,   0,   0,   0,   0,   0,  -5,
+        0,   0,   0,   5,   5,   0,   0,   0 },
+    // Knight
+    { -50, -40, -30, -30, -30, -30, -40, -50,
+      -40, -20,   0,   0,   0,   0, -20, -40,
+      -30,   0,  10,  15,  15,  10,   0, -30,
+      -30,   5,  15,  20,  20,  15,   5, -30,
+      -30,   0,  15,  20,  20,  15,   0, -30,
+      -30,   5,  10,  15,  15,  10,   5, -30,
+      -40, -20,   0,   5,   5,   0, -20, -40,
+      -50, -40, -30, -30, -30, -30, -40, -50 },
+    // Bishop
+    { -20, -10, -10, -10, -10, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,  10,  10,   5,   0, -10,
+      -10,   5,   5,  10,  10,   5,   5, -10,
+      -10,   0,  10,  10,  10,  10,   0, -10,
+      -10,  10,  10,  10,  10,  10,  10, -10,
+      -10,   5,   0,   0,   0,   0,   5, -10,
+      -20, -10, -10, -10, -10, -10, -10, -20 },
+    // Queen
+    { -20, -10, -10,  -5,  -5, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,   5,   5,   5,   0, -10,
+       -5,   0,   5,   5,   5,   5,   0,  -5,
+        0,   0,   5,   5,   5,   5,   0,  -5,
+      -10,   5,   5,   5,   5,   5,   0, -10,
+      -10,   0,   5,   0,   0,   0,   0, -10,
+      -20, -10, -10,  -5,  -5, -10, -10, -20 },
+    // King, behind its pawns
+    { -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -30, -40, -40, -50, -50, -40, -40, -30,
+      -20, -30, -30, -40, -40, -30, -30, -20,
+      -10, -20, -20, -20, -20, -20, -20, -10,
+       20,  20,   0,   0,   0,   0,  20,  20,
+       20,  30,  10,   0,   0,  10,  30,  20 },
+};
+
+constexpr int EndgameSquares[6][64] = {
+    // Pawn, worth more the closer it is to promoting
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+       80,  80,  80,  80,  80,  80,  80,  80,
+       50,  50,  50,  50,  50,  50,  50,  50,
+       30,  30,  30,  30,  30,  30,  30,  30,
+       20,  20,  20,  20,  20,  20,  20,  20,
+       10,  10,  10,  10,  10,  10,  10,  10,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0 },
+    // Rook
+    {   0,   0,   0,   0,   0,   0,   0,   0,
+        5,  10,  10,  10,  10,  10,  10,   5,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,   0,   0,   0,   0,   0,   0,   0 },
+    // Knight
+    { -50, -40, -30, -30, -30, -30, -40, -50,
+      -40, -20,   0,   0,   0,   0, -20, -40,
+      -30,   0,  10,  15,  15,  10,   0, -30,
+      -30,   5,  15,  20,  20,  15,   5, -30,
+      -30,   0,  15,  20,  20,  15,   0, -30,
+      -30,   5,  10,  15,  15,  10,   5, -30,
+      -40, -20,   0,   5,   5,   0, -20, -40,
+      -50, -40, -30, -30, -30, -30, -40, -50 },
+    // Bishop
+    { -20, -10, -10, -10, -10, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,  10,  10,   5,   0, -10,
+      -10,   5,   5,  10,  10,   5,   5, -10,
+      -10,   0,  10,  10,  10,  10,   0, -10,
+      -10,  10,  10,  10,  10,  10,  10, -10,
+      -10,   5,   0,   0,   0,   0,   5, -10,
+      -20, -10, -10, -10, -10, -10, -10, -20 },
+    // Queen
+    { -20, -10, -10,  -5,  -5, -10, -10, -20,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -10,   0,   5,   5,   5,   5,   0, -10,
+       -5,   0,   5,   5,   5,   5,   0,  -5,
+       -5,   0,   5,   5,   5,   5,   0,  -5,
+      -10,   0,   5,   5,   5,   5,   0, -10,
+      -10,   0,   0,   0,   0,   0,   0, -10,
+      -20, -10, -10,  -5,  -5, -10, -10, -20 },
+    // King, out to the center
+    { -50, -40, -30, -20, -20, -30, -40, -50,
+      -30, -20, -10,   0,   0, -10, -20, -30,
+      -30, -10,  20,  30,  30,  20, -10, -30,
+      -30, -10,  30,  40,  40,  30, -10, -30,
+      -30, -10,  30,  40,  40,  30, -10, -30,
+      -30, -10,  20,  30,  30,  20, -10, -30,
+      -30, -30,   0,   0,   0,   0, -30, -30,
+      -50, -30, -30, -30, -30, -30, -30, -50 },
+};
+
+// what one piece adds to the running scores of a board, white positive and
+// black negative, and to the phase
+struct PieceScore
+{
+    int midgame;
+    int endgame;
+    int phase;
+};
+
+constexpr PieceScore pieceScore(int side, int p, int sq)
+{
+    return side ? PieceScore{ -(MidgameMaterial[p] + MidgameSquares[p][sq]),
+                              -(EndgameMaterial[p] + EndgameSquares[p][sq]), PhaseWeights[p] }
+                : PieceScore{ MidgameMaterial[p] + MidgameSquares[p][sq ^ 56],
+                              EndgameMaterial[p] + EndgameSquares[p][sq ^ 56], PhaseWeights[p] };
+}
+
+// the scores by side, piece - Pawn and square, worked out when compiling so
+// putting down or taking off a piece is a single lookup
+template <typename> struct ScoreTables;
+
+template <int... I>
+struct ScoreTables<Indices<I...> >
+{
+    static constexpr PieceScore score[2][6][64] = {
+        { { pieceScore(0, 0, I)... }, { pieceScore(0, 1, I)... }, { pieceScore(0, 2, I)... },
+          { pieceScore(0, 3, I)... }, { pieceScore(0, 4, I)... }, { pieceScore(0, 5, I)... } },
+        { { pieceScore(1, 0, I)... }, { pieceScore(1, 1, I)... }, { pieceScore(1, 2, I)... },
+          { pieceScore(1, 3, I)... }, { pieceScore(1, 4, I)... }, { pieceScore(1, 5, I)... } },
+    };
+};
+
+template <int... I> constexpr PieceScore ScoreTables<Indices<I...> >::score[2][6][64];
+
+typedef ScoreTables<MakeIndices<64>::type> Scores;
+
+#endif
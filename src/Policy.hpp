@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef Policy_hpp
+#define Policy_hpp
+#include "Chess.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// light playout policies for Board::move and Board::playout, see RandomPolicy
+// in Chess.hpp for what a policy is
+//
+//   board.move(checkMate, draw, SafePolicy());
+//   board.playout(200, random, GreedyPolicy(0.2f));
+
+// a random capture or promotion when there is one, otherwise any move
+struct CapturePolicy
+{
+    const Move *operator()(Board& board, const Moves& moves, Random& random) const
+    {
+        unsigned captures[MaxMoves];
+        unsigned count = 0;
+        for (unsigned i = 0; i < moves.size(); ++i) {
+            const Move& move = moves[i];
+            if ((board.pieceOn(move.to()) != Empty) || move.isEnpassant() || move.isPromotion()) {
+                captures[count++] = i;
+            }
+        }
+        if (count) { return &moves[captures[random.below(count)]]; }
+        return &moves[random.below(moves.size())];
+    }
+};
+
+// a random move that does not lose material by static exchange, so pieces
+// are not left hanging, after tries draws that all lose any move will do
+struct SafePolicy
+{
+    explicit SafePolicy(int _tries = 4)
+        : tries(_tries)
+    {
+    }
+
+    const Move *operator()(Board& board, const Moves& moves, Random& random) const
+    {
+        return board.safeMove(moves, random, tries);
+    }
+
+    int tries;
+};
+
+// the move with the best evaluation one ply on, ties broken at random, and
+// a random move instead with chance epsilon
+struct GreedyPolicy
+{
+    explicit GreedyPolicy(float _epsilon = 0.1f)
+        : epsilon(_epsilon)
+    {
+    }
+
+    const Move *operator()(Board& board, const Moves& moves, Random& random) const
+    {
+        if (random.unit() < epsilon) { return &moves[random.below(moves.size())]; }
+        const Move *best = &moves[0];
+        int bestScore = board.evaluateAfter(moves[0]);
+        unsigned ties = 1;
+        for (unsigned i = 1; i < moves.size(); ++i) {
+            const int score = board.evaluateAfter(moves[i]);
+            if (score > bestScore) {
+                best = &moves[i];
+                bestScore = score;
+                ties = 1;
+            } else if ((score == bestScore) && (random.below(++ties) == 0)) {
+                best = &moves[i];
+            }
+        }
+        return best;
+    }
+
+    float epsilon;
+};
+
+#endif
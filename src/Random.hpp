@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef Random_hpp
+#define Random_hpp
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// small fast generator, PCG32 (XSH RR), one per board or per thread
+class Random
+{
+public:
+    Random(uint64_t seed = 0)
+    {
+        setSeed(seed);
+    }
+
+    void setSeed(uint64_t seed)
+    {
+        state = 0;
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next()
+    {
+        const uint64_t old = state;
+        state = old * 6364136223846793005ULL + Increment;
+        const uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        const uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // a number in [0, n), the high half of a 32 x 32 bit multiply
+    // instead of a divide, the bias is at most n / 2^32
+    uint32_t below(uint32_t n)
+    {
+        return (uint32_t)(((uint64_t)next() * n) >> 32);
+    }
+
+    // a number in [0, 1)
+    float unit()
+    {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+private:
+    static const uint64_t Increment = 1442695040888963407ULL;
+    uint64_t state;
+};
+
+#endif
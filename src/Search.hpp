@@ -0,0 +1,528 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef Search_hpp
+#define Search_hpp
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Chess.hpp"
+#include "TransTable.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// what the last completed iteration of a search found
+struct SearchInfo
+{
+    SearchInfo()
+        : depth(0)
+        , score(0)
+        , nodes(0)
+        , millis(0)
+    {
+    }
+
+    unsigned long nodesPerSecond() const { return millis ? (unsigned long)(nodes * 1000 / millis) : 0; }
+
+    int depth;
+    // centipawns for the side to move, mates are near Search::MateScore
+    int score;
+    uint64_t nodes;
+    unsigned long millis;
+    // principal variation, the best move first
+    Moves pv;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// negamax alpha-beta with iterative deepening and aspiration windows, moves
+// are tried hash move first, then captures by most valuable victim and least
+// valuable attacker, then killer moves, then captures that lose material by
+// static exchange and then by history, the leaves are resolved by a
+// quiescence search over captures and promotions, the evaluation is the
+// running material and piece square score Board keeps
+//
+// a search stops at maxDepth, after maxNodes nodes or after maxMillis
+// milliseconds, whichever comes first, only completed iterations count
+//
+// with more than one thread it is a lazy SMP search, every thread searches
+// the root on its own board with its own killers and history, they share
+// only the hash table so one thread finds the cutoffs of another there,
+// helper threads skip some depths so they run ahead of the main thread,
+// the result is the deepest iteration any of them completed
+class Search
+{
+public:
+    static const int MaxPly = 128;
+    static const int Infinite = 32001;
+    static const int MateScore = 32000;
+    // scores beyond this are mates found within MaxPly
+    static const int MateBound = MateScore - MaxPly;
+    static const unsigned MaxThreads = 128;
+
+    Search(TransTable& table, unsigned numThreads = 1)
+        : shared(table)
+    {
+        setThreads(numThreads);
+    }
+
+    // threads keep their history from one search to the next
+    void setThreads(unsigned numThreads)
+    {
+        numThreads = (numThreads < 1) ? 1 : (numThreads > MaxThreads) ? MaxThreads : numThreads;
+        threads.resize(numThreads);
+        for (unsigned t = 0; t < numThreads; ++t) {
+            if (!threads[t]) { threads[t].reset(new Thread(shared, t)); }
+        }
+    }
+
+    unsigned getThreads() const { return threads.size(); }
+
+    void search(const Board& position, int maxDepth, uint64_t maxNodes = 0, unsigned long maxMillis = 0)
+    {
+        search(position, maxDepth, maxNodes, maxMillis, [](const SearchInfo&) {});
+    }
+
+    // report(info) is called after each iteration that is deeper than any
+    // before it, from whichever thread completed it, one call at a time
+    template <typename Report>
+    void search(const Board& position, int maxDepth, uint64_t maxNodes, unsigned long maxMillis,
+                Report report)
+    {
+        shared.start = std::chrono::steady_clock::now();
+        shared.maxNodes = maxNodes;
+        shared.maxMillis = maxMillis;
+        shared.nodes.store(0);
+        shared.stop.store(false);
+        shared.canStop.store(false);
+        shared.result = SearchInfo();
+        shared.table.newSearch();
+        if (maxDepth > MaxPly - 1) { maxDepth = MaxPly - 1; }
+        std::vector<std::thread> helpers;
+        for (unsigned t = 1; t < threads.size(); ++t) {
+            helpers.push_back(std::thread(&Thread::template run<Report>, threads[t].get(),
+                                          std::cref(position), maxDepth, report));
+        }
+        threads[0]->run(position, maxDepth, report);
+        for (unsigned t = 0; t < helpers.size(); ++t) {
+            helpers[t].join();
+        }
+        uint64_t nodes = 0;
+        for (unsigned t = 0; t < threads.size(); ++t) {
+            nodes += threads[t]->getNodes();
+        }
+        shared.result.nodes = nodes;
+        shared.result.millis = shared.elapsedMillis();
+    }
+
+    // the first move of the principal variation, false if there is none
+    bool bestMove(Move& move) const
+    {
+        if (shared.result.pv.empty()) { return false; }
+        move = shared.result.pv[0];
+        return true;
+    }
+
+    const SearchInfo& info() const { return shared.result; }
+
+    // nodes searched by one thread in the last search
+    uint64_t threadNodes(unsigned t) const { return threads[t]->getNodes(); }
+
+private:
+    // what the threads of a search have in common
+    struct Shared
+    {
+        Shared(TransTable& _table)
+            : table(_table)
+            , maxNodes(0)
+            , maxMillis(0)
+            , nodes(0)
+            , stop(false)
+            , canStop(false)
+        {
+        }
+
+        // threads add their nodes in batches and look at the limits then
+        void addNodes(uint64_t count)
+        {
+            const uint64_t total = nodes.fetch_add(count, std::memory_order_relaxed) + count;
+            if (!canStop.load(std::memory_order_relaxed)) { return; }
+            if ((maxNodes && (total >= maxNodes)) || (maxMillis && (elapsedMillis() >= maxMillis))) {
+                stop.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        unsigned long elapsedMillis() const
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+
+        TransTable& table;
+        uint64_t maxNodes;
+        unsigned long maxMillis;
+        std::chrono::steady_clock::time_point start;
+        // nodes of all threads, up to the last batch each
+        std::atomic<uint64_t> nodes;
+        std::atomic<bool> stop;
+        // limits are only looked at once the first iteration is done
+        std::atomic<bool> canStop;
+        // the deepest completed iteration, under lock
+        std::mutex lock;
+        SearchInfo result;
+    };
+
+    // one search thread and the state it does not share
+    class Thread
+    {
+    public:
+        Thread(Shared& _shared, unsigned _id)
+            : shared(_shared)
+            , id(_id)
+            , nodes(0)
+        {
+            clearHistory();
+        }
+
+        template <typename Report>
+        void run(const Board& position, int maxDepth, Report report)
+        {
+            board = position;
+            nodes = 0;
+            memset(killers, 0, sizeof(killers));
+            ageHistory();
+            int score = 0;
+            for (int depth = 1; depth <= maxDepth; ++depth) {
+                if (skipDepth(depth)) { continue; }
+                score = aspiration(depth, score);
+                if (stopped()) { break; }
+                if (complete(depth, maxDepth, score, report)) { break; }
+            }
+            shared.nodes.fetch_add(nodes & 1023, std::memory_order_relaxed);
+        }
+
+        uint64_t getNodes() const { return nodes; }
+
+        int evaluate() const { return board.evaluate(); }
+
+    private:
+        // helper threads search every depth, every other depth or fewer,
+        // starting at different points, so they are spread over the depths
+        // around the main thread instead of all on the same one
+        bool skipDepth(int depth) const
+        {
+            if (id == 0) { return false; }
+            static const int size[20] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+            static const int phase[20] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+            const unsigned i = (id - 1) % 20;
+            return ((depth + phase[i]) / size[i]) % 2 != 0;
+        }
+
+        // keep the iteration if it is the deepest so far, true if the
+        // search is over, at the last depth or with a mate found
+        template <typename Report>
+        bool complete(int depth, int maxDepth, int score, Report& report)
+        {
+            std::lock_guard<std::mutex> guard(shared.lock);
+            SearchInfo& result = shared.result;
+            if (depth > result.depth) {
+                result.depth = depth;
+                result.score = score;
+                result.nodes = shared.nodes.load(std::memory_order_relaxed) + (nodes & 1023);
+                result.millis = shared.elapsedMillis();
+                result.pv.clear();
+                for (int i = 0; i < pvLength[0]; ++i) {
+                    result.pv.insert(pv[0][i]);
+                }
+                report(result);
+                // the first iteration always finishes so there is a move
+                shared.canStop.store(true, std::memory_order_relaxed);
+            }
+            const bool mate = (score >= MateScore - depth) || (score <= -MateScore + depth);
+            if ((depth >= maxDepth) || mate || (pvLength[0] == 0)) {
+                shared.stop.store(true, std::memory_order_relaxed);
+                return true;
+            }
+            return false;
+        }
+
+        // a window around the last score, widened on the side that failed
+        int aspiration(int depth, int last)
+        {
+            int delta = 25;
+            int alpha = -Infinite;
+            int beta = Infinite;
+            if (depth >= 4) {
+                alpha = (last - delta > -Infinite) ? last - delta : -Infinite;
+                beta = (last + delta < Infinite) ? last + delta : Infinite;
+            }
+            for (;;) {
+                const int score = negamax(alpha, beta, depth, 0);
+                if (stopped()) { return score; }
+                if (score <= alpha) {
+                    alpha = (score - delta > -Infinite) ? score - delta : -Infinite;
+                } else if (score >= beta) {
+                    beta = (score + delta < Infinite) ? score + delta : Infinite;
+                } else {
+                    return score;
+                }
+                delta *= 2;
+            }
+        }
+
+        int negamax(int alpha, int beta, int depth, int ply)
+        {
+            pvLength[ply] = 0;
+            const Side us = board.getTurn();
+            const bool check = board.inCheck(us);
+            // look one ply further out of check
+            if (check) { ++depth; }
+            if (depth <= 0) { return quiesce(alpha, beta, ply); }
+            if ((++nodes & 1023) == 0) { shared.addNodes(1024); }
+            if (stopped()) { return 0; }
+            if (ply > 0) {
+                if (isDraw()) { return 0; }
+                // no mate found further away can beat one already found closer
+                if (alpha < -MateScore + ply) { alpha = -MateScore + ply; }
+                if (beta > MateScore - ply - 1) { beta = MateScore - ply - 1; }
+                if (alpha >= beta) { return alpha; }
+            }
+            if (ply >= MaxPly - 1) { return evaluate(); }
+            const bool pvNode = (beta - alpha) > 1;
+            const uint64_t key = board.getKey();
+            Move hashMove = Move::fromRaw(0);
+            TransEntry entry;
+            if (shared.table.probe(key, entry)) {
+                hashMove = entry.move;
+                if (!pvNode && (entry.depth >= depth)) {
+                    const int score = fromTable(entry.score, ply);
+                    if ((entry.bound == TransEntry::Exact) ||
+                        ((entry.bound == TransEntry::Lower) && (score >= beta)) ||
+                        ((entry.bound == TransEntry::Upper) && (score <= alpha))) {
+                        return score;
+                    }
+                }
+            }
+            Moves moves;
+            board.legalMoves(us, moves);
+            if (moves.empty()) { return check ? -MateScore + ply : 0; }
+            const int eval = check ? 0 : evaluate();
+            // far enough above beta that a shallow search will not come back down
+            if (!pvNode && !check && (depth <= 3) && (eval - 120 * depth >= beta) && (beta > -MateBound)) {
+                return eval;
+            }
+            int scores[MaxMoves];
+            scoreMoves(moves, scores, hashMove, ply);
+            const int oldAlpha = alpha;
+            int best = -Infinite;
+            Move bestMove = Move::fromRaw(0);
+            for (unsigned i = 0; i < moves.size(); ++i) {
+                const Move move = pickMove(moves, scores, i);
+                const bool quiet = isQuiet(move);
+                UndoInfo undo;
+                board.makeMove(move, undo);
+                int score;
+                // the first move gets the full window, the rest a null window
+                // to prove they are worse and a full one only if they are not
+                if (i == 0) {
+                    score = -negamax(-beta, -alpha, depth - 1, ply + 1);
+                } else {
+                    score = -negamax(-alpha - 1, -alpha, depth - 1, ply + 1);
+                    if ((score > alpha) && (score < beta)) {
+                        score = -negamax(-beta, -alpha, depth - 1, ply + 1);
+                    }
+                }
+                board.unmakeMove(move, undo);
+                if (stopped()) { return 0; }
+                if (score <= best) { continue; }
+                best = score;
+                if (score <= alpha) { continue; }
+                alpha = score;
+                bestMove = move;
+                updatePv(ply, move);
+                if (alpha >= beta) {
+                    if (quiet) { updateKillers(move, us, depth, ply); }
+                    break;
+                }
+            }
+            const TransEntry::Bound bound = (best >= beta) ? TransEntry::Lower :
+                                            (best > oldAlpha) ? TransEntry::Exact : TransEntry::Upper;
+            shared.table.store(key, bestMove, toTable(best, ply), eval, depth, bound);
+            return best;
+        }
+
+        // only captures and queen promotions that do not lose material, unless
+        // in check, so the static score is not taken in the middle of an exchange
+        int quiesce(int alpha, int beta, int ply)
+        {
+            pvLength[ply] = 0;
+            if ((++nodes & 1023) == 0) { shared.addNodes(1024); }
+            if (stopped()) { return 0; }
+            if (ply >= MaxPly - 1) { return evaluate(); }
+            const Side us = board.getTurn();
+            const bool check = board.inCheck(us);
+            Moves moves;
+            board.legalMoves(us, moves);
+            int best = -Infinite;
+            if (check) {
+                if (moves.empty()) { return -MateScore + ply; }
+            } else {
+                // standing pat, the side to move need not capture
+                best = evaluate();
+                if (best >= beta) { return best; }
+                if (best > alpha) { alpha = best; }
+            }
+            int scores[MaxMoves];
+            scoreMoves(moves, scores, Move::fromRaw(0), ply);
+            for (unsigned i = 0; i < moves.size(); ++i) {
+                const Move move = pickMove(moves, scores, i);
+                if (!check && (scores[i] < Captures)) { break; }
+                UndoInfo undo;
+                board.makeMove(move, undo);
+                const int score = -quiesce(-beta, -alpha, ply + 1);
+                board.unmakeMove(move, undo);
+                if (stopped()) { return 0; }
+                if (score <= best) { continue; }
+                best = score;
+                if (score <= alpha) { continue; }
+                alpha = score;
+                updatePv(ply, move);
+                if (alpha >= beta) { break; }
+            }
+            return best;
+        }
+
+        // move ordering keys, the hash move, then captures and queen promotions
+        // that do not lose material, then the two killers, then captures that
+        // do, then quiet moves by history
+        static const int HashMove = 1 << 30;
+        static const int Captures = 1 << 28;
+        static const int Killer = 1 << 27;
+        static const int BadCaptures = 1 << 26;
+        static const int MaxHistory = 1 << 20;
+
+        void scoreMoves(const Moves& moves, int *scores, const Move& hashMove, int ply) const
+        {
+            // victims and attackers in order of value, the king attacks last
+            static const int order[King + 1] = { 0, 1, 4, 2, 3, 5, 6 };
+            const int side = Board::sideIndex(board.getTurn());
+            for (unsigned i = 0; i < moves.size(); ++i) {
+                const Move& move = moves[i];
+                const Piece victim = move.isEnpassant() ? Pawn : board.pieceOn(move.to());
+                if (move == hashMove) {
+                    scores[i] = HashMove;
+                } else if ((victim != Empty) || (move.getPromotion() == Queen)) {
+                    const Piece attacker = board.pieceOn(move.from());
+                    // only taking a piece worth less than the attacker can lose
+                    const bool losing = (PieceValues[attacker] > PieceValues[victim]) && (board.see(move) < 0);
+                    scores[i] = (losing ? BadCaptures : Captures) +
+                                8 * (order[victim] + order[move.getPromotion()]) - order[attacker];
+                } else if (move == killers[ply][0]) {
+                    scores[i] = Killer + 1;
+                } else if (move == killers[ply][1]) {
+                    scores[i] = Killer;
+                } else {
+                    scores[i] = history[side][move.from()][move.to()];
+                }
+            }
+        }
+
+        // move the best scored of the moves from i on to i, a selection sort
+        // done one step at a time since a cutoff often comes early
+        static Move pickMove(Moves& moves, int *scores, unsigned i)
+        {
+            unsigned best = i;
+            for (unsigned j = i + 1; j < moves.size(); ++j) {
+                if (scores[j] > scores[best]) { best = j; }
+            }
+            if (best != i) {
+                Move *list = moves.begin();
+                const Move move = list[i];
+                list[i] = list[best];
+                list[best] = move;
+                const int score = scores[i];
+                scores[i] = scores[best];
+                scores[best] = score;
+            }
+            return moves[i];
+        }
+
+        bool isQuiet(const Move& move) const
+        {
+            return (board.pieceOn(move.to()) == Empty) && !move.isEnpassant() && !move.isPromotion();
+        }
+
+        void updateKillers(const Move& move, Side us, int depth, int ply)
+        {
+            if (killers[ply][0] != move) {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = move;
+            }
+            int& count = history[Board::sideIndex(us)][move.from()][move.to()];
+            count += depth * depth;
+            if (count >= MaxHistory) { ageHistory(); }
+        }
+
+        void updatePv(int ply, const Move& move)
+        {
+            pv[ply][0] = move;
+            for (int i = 0; i < pvLength[ply + 1]; ++i) {
+                pv[ply][i + 1] = pv[ply + 1][i];
+            }
+            pvLength[ply] = pvLength[ply + 1] + 1;
+        }
+
+        void clearHistory() { memset(history, 0, sizeof(history)); }
+
+        // older cutoffs count for less
+        void ageHistory()
+        {
+            int *count = &history[0][0][0];
+            for (unsigned i = 0; i < sizeof(history) / sizeof(int); ++i) {
+                count[i] /= 2;
+            }
+        }
+
+        // a repetition inside the search is scored as the draw it can be forced into
+        bool isDraw() const
+        {
+            return (board.getHalfmoveClock() >= 100) || board.insufficientMaterial() ||
+                   (board.repetitions() >= 1);
+        }
+
+        // mate scores are kept in the table as distance from the node, not the root
+        static int toTable(int score, int ply)
+        {
+            return (score >= MateBound) ? score + ply : (score <= -MateBound) ? score - ply : score;
+        }
+
+        static int fromTable(int score, int ply)
+        {
+            return (score >= MateBound) ? score - ply : (score <= -MateBound) ? score + ply : score;
+        }
+
+        bool stopped() const { return shared.stop.load(std::memory_order_relaxed); }
+
+        Shared& shared;
+        // 0 is the main thread
+        unsigned id;
+        Board board;
+        uint64_t nodes;
+        // triangular table, pv[ply] is the best line found from ply
+        Move pv[MaxPly][MaxPly];
+        int pvLength[MaxPly];
+        // two quiet moves per ply that last caused a cutoff
+        Move killers[MaxPly][2];
+        // cutoffs by quiet moves, side, from and to
+        int history[2][64][64];
+    };
+
+    Shared shared;
+    std::vector<std::unique_ptr<Thread>> threads;
+};
+
+#endif
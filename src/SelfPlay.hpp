@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef SelfPlay_hpp
+#define SelfPlay_hpp
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Chess.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// game results counted by one worker, merged when the batch is done
+struct SelfPlayCounts
+{
+    SelfPlayCounts()
+        : games(0)
+        , whiteWins(0)
+        , blackWins(0)
+        , draws(0)
+        , unfinished(0)
+    {
+    }
+
+    void add(Result result)
+    {
+        ++games;
+        switch (result)
+        {
+        case WhiteWin: ++whiteWins; break;
+        case BlackWin: ++blackWins; break;
+        case Draw: ++draws; break;
+        default: ++unfinished; break;
+        }
+    }
+
+    void add(const SelfPlayCounts& other)
+    {
+        games += other.games;
+        whiteWins += other.whiteWins;
+        blackWins += other.blackWins;
+        draws += other.draws;
+        unfinished += other.unfinished;
+    }
+
+    unsigned long games;
+    unsigned long whiteWins;
+    unsigned long blackWins;
+    unsigned long draws;
+    // games that hit the ply limit
+    unsigned long unfinished;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// plays a batch of games over a number of worker threads, each worker starts
+// with an even share of the game numbers and when it runs out it steals half
+// of what is left from the busiest worker, so short games do not leave
+// threads idle at the end of a batch
+class SelfPlay
+{
+public:
+    static const unsigned MaxWorkers = 128;
+
+    SelfPlay(unsigned _numWorkers = std::thread::hardware_concurrency())
+        : numWorkers((_numWorkers < 1) ? 1 : (_numWorkers > MaxWorkers) ? MaxWorkers : _numWorkers)
+    {
+    }
+
+    unsigned getNumWorkers() const { return numWorkers; }
+
+    // play games 0 to numGames - 1, game(worker, index) plays one game and
+    // returns its Result, it is called from many threads at once
+    template <typename Game>
+    SelfPlayCounts run(unsigned numGames, Game game)
+    {
+        for (unsigned w = 0; w < numWorkers; ++w) {
+            workers[w].next = (unsigned)((unsigned long)numGames * w / numWorkers);
+            workers[w].end = (unsigned)((unsigned long)numGames * (w + 1) / numWorkers);
+            workers[w].counts = SelfPlayCounts();
+        }
+        std::vector<std::thread> threads;
+        for (unsigned w = 1; w < numWorkers; ++w) {
+            threads.push_back(std::thread(&SelfPlay::work<Game>, this, w, game));
+        }
+        work(0, game);
+        for (unsigned t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+        }
+        SelfPlayCounts total;
+        for (unsigned w = 0; w < numWorkers; ++w) {
+            total.add(workers[w].counts);
+        }
+        return total;
+    }
+
+    // what one worker did in the last batch
+    const SelfPlayCounts& workerCounts(unsigned worker) const { return workers[worker].counts; }
+
+private:
+    // each worker on its own cache lines, the range that thieves lock and
+    // read on one and the counts only the owner touches on the next, so
+    // neither stealing nor counting bounces the other's line
+    struct alignas(64) Worker
+    {
+        std::mutex lock;
+        // the game numbers not yet started, next to end - 1
+        unsigned next;
+        unsigned end;
+        alignas(64) SelfPlayCounts counts;
+    };
+
+    template <typename Game>
+    void work(unsigned w, Game game)
+    {
+        unsigned idx;
+        while (take(w, idx) || steal(w, idx)) {
+            workers[w].counts.add(game(w, idx));
+        }
+    }
+
+    // the owner takes games from the front of its range
+    bool take(unsigned w, unsigned& idx)
+    {
+        Worker& worker = workers[w];
+        std::lock_guard<std::mutex> guard(worker.lock);
+        if (worker.next >= worker.end) { return false; }
+        idx = worker.next++;
+        return true;
+    }
+
+    // thieves take the back half of the worker with the most games left
+    bool steal(unsigned w, unsigned& idx)
+    {
+        for (;;) {
+            unsigned victim = w;
+            unsigned most = 0;
+            for (unsigned v = 0; v < numWorkers; ++v) {
+                const unsigned left = remaining(v);
+                if (left > most) {
+                    most = left;
+                    victim = v;
+                }
+            }
+            if (most == 0) { return false; }
+            unsigned from, to;
+            {
+                std::lock_guard<std::mutex> guard(workers[victim].lock);
+                Worker& other = workers[victim];
+                if (other.next >= other.end) { continue; }
+                to = other.end;
+                from = other.end - (other.end - other.next + 1) / 2;
+                other.end = from;
+            }
+            std::lock_guard<std::mutex> guard(workers[w].lock);
+            workers[w].next = from + 1;
+            workers[w].end = to;
+            idx = from;
+            return true;
+        }
+    }
+
+    unsigned remaining(unsigned v)
+    {
+        std::lock_guard<std::mutex> guard(workers[v].lock);
+        return workers[v].end - workers[v].next;
+    }
+
+    unsigned numWorkers;
+    Worker workers[MaxWorkers];
+};
+
+#endif
@@ -0,0 +1,195 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+////////////////////////////////////////////////////////////////////////////////
+#ifndef TransTable_hpp
+#define TransTable_hpp
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include "Chess.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// what a search learned about a position, unpacked from the table
+struct TransEntry
+{
+    enum Bound { None, Upper, Lower, Exact };
+
+    Move move;
+    int score;
+    int eval;
+    int depth;
+    Bound bound;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// a fixed size hash table of search results shared by all threads without
+// locks, each entry is two 64 bit words written with separate atomic stores,
+// the first holds key ^ data so a torn write from two threads fails the key
+// check on probe instead of returning a mix of two positions
+//
+// data bits: 0..15 move, 16..31 score, 32..47 eval, 48..55 depth,
+// 56..57 bound, 58..63 age
+class TransTable
+{
+public:
+    // four entries of 16 bytes share a bucket of one cache line
+    static const unsigned BucketSize = 4;
+
+    TransTable(size_t megabytes = 16)
+        : table(0)
+        , numBuckets(0)
+        , age(0)
+    {
+        resize(megabytes);
+    }
+
+    // the largest power of two number of buckets that fits, this clears the table
+    void resize(size_t megabytes)
+    {
+        size_t buckets = 1;
+        while ((buckets * 2) * sizeof(Bucket) <= megabytes * 1024 * 1024) {
+            buckets *= 2;
+        }
+        // new does not align past 16 bytes before C++17, so round up by hand
+        memory.reset(new Entry[buckets * BucketSize + BucketSize - 1]);
+        const uintptr_t address = ((uintptr_t)memory.get() + sizeof(Bucket) - 1) & ~(uintptr_t)(sizeof(Bucket) - 1);
+        table = (Bucket *)address;
+        numBuckets = buckets;
+        clear();
+    }
+
+    // not safe while other threads use the table
+    void clear()
+    {
+        for (size_t b = 0; b < numBuckets; ++b) {
+            for (unsigned i = 0; i < BucketSize; ++i) {
+                table[b].entries[i].check.store(0, std::memory_order_relaxed);
+                table[b].entries[i].data.store(0, std::memory_order_relaxed);
+            }
+        }
+        age = 0;
+    }
+
+    // entries from earlier searches are replaced first
+    void newSearch() { age = (age + 1) & AgeMask; }
+
+    bool probe(uint64_t key, TransEntry& entry) const
+    {
+        const Bucket& bucket = table[key & (numBuckets - 1)];
+        for (unsigned i = 0; i < BucketSize; ++i) {
+            const uint64_t data = bucket.entries[i].data.load(std::memory_order_relaxed);
+            const uint64_t check = bucket.entries[i].check.load(std::memory_order_relaxed);
+            if (((check ^ data) == key) && data) {
+                unpack(data, entry);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // keep the result for key, an entry of the same position is refreshed,
+    // otherwise the shallowest and oldest entry of the bucket gives way
+    void store(uint64_t key, const Move& move, int score, int eval, int depth, TransEntry::Bound bound)
+    {
+        Bucket& bucket = table[key & (numBuckets - 1)];
+        Entry *replace = &bucket.entries[0];
+        int worst = 0x7FFFFFFF;
+        for (unsigned i = 0; i < BucketSize; ++i) {
+            Entry& slot = bucket.entries[i];
+            const uint64_t data = slot.data.load(std::memory_order_relaxed);
+            const uint64_t check = slot.check.load(std::memory_order_relaxed);
+            if ((check ^ data) == key) {
+                // a deeper result from this search is worth more than this one
+                if ((depth < dataDepth(data) - 2) && (dataAge(data) == age) && (bound != TransEntry::Exact)) {
+                    return;
+                }
+                replace = &slot;
+                // keep the old best move if there is no new one
+                if ((move.raw() == 0) && data) {
+                    store(slot, key, Move::fromRaw((uint16_t)data), score, eval, depth, bound);
+                    return;
+                }
+                break;
+            }
+            // each search of age counts as eight plies of depth
+            const int value = dataDepth(data) - 8 * ((age - dataAge(data)) & AgeMask);
+            if (value < worst) {
+                worst = value;
+                replace = &slot;
+            }
+        }
+        store(*replace, key, move, score, eval, depth, bound);
+    }
+
+    void prefetch(uint64_t key) const
+    {
+        __builtin_prefetch(&table[key & (numBuckets - 1)]);
+    }
+
+    // entries per thousand used by the current search, from a sample
+    int hashfull() const
+    {
+        int used = 0;
+        const size_t sample = (numBuckets < 250) ? numBuckets : 250;
+        for (size_t b = 0; b < sample; ++b) {
+            for (unsigned i = 0; i < BucketSize; ++i) {
+                const uint64_t data = table[b].entries[i].data.load(std::memory_order_relaxed);
+                if (data && (dataAge(data) == age)) { ++used; }
+            }
+        }
+        return (int)(used * 1000 / (sample * BucketSize));
+    }
+
+    size_t size() const { return numBuckets * BucketSize; }
+
+private:
+    static const unsigned AgeMask = 63;
+
+    struct Entry
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    struct Bucket
+    {
+        Entry entries[BucketSize];
+    };
+    static_assert(sizeof(Bucket) == 64, "a bucket should fill one cache line");
+
+    void store(Entry& slot, uint64_t key, const Move& move, int score, int eval, int depth,
+               TransEntry::Bound bound)
+    {
+        const uint64_t data = (uint64_t)move.raw()
+                            | ((uint64_t)(uint16_t)(int16_t)score << 16)
+                            | ((uint64_t)(uint16_t)(int16_t)eval << 32)
+                            | ((uint64_t)(uint8_t)(int8_t)depth << 48)
+                            | ((uint64_t)bound << 56)
+                            | ((uint64_t)age << 58);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+    }
+
+    static void unpack(uint64_t data, TransEntry& entry)
+    {
+        entry.move = Move::fromRaw((uint16_t)data);
+        entry.score = (int16_t)(data >> 16);
+        entry.eval = (int16_t)(data >> 32);
+        entry.depth = dataDepth(data);
+        entry.bound = (TransEntry::Bound)((data >> 56) & 3);
+    }
+
+    static int dataDepth(uint64_t data) { return (int8_t)(data >> 48); }
+    static unsigned dataAge(uint64_t data) { return (unsigned)(data >> 58); }
+
+    std::unique_ptr<Entry[]> memory;
+    // the buckets, on cache line boundaries inside memory
+    Bucket *table;
+    size_t numBuckets;
+    unsigned age;
+};
+
+#endif
@@ -1,12 +1,9 @@
-#include <thread>
 #include <sys/time.h>
-#include "Chess.hpp"
+#include "SelfPlay.hpp"
+#include "Policy.hpp"
 
 bool debug = false;
 
-int whiteWin[8];
-int blackWin[8];
-
 void printBoard(const Board& board, const char *reason)
 {
     std::string boardStr;
@@ -28,77 +25,104 @@ void printCheckMateBoard(const Board& board, Side sideWin, Side sideLose)
     printf("game moves:\n%s\n\n", movesStr.c_str());
 }
 
-void playGame(int idx, int loops, int plays)
+// play one game of up to plays moves, policy picks the moves
+template <typename Policy>
+Result playGame(unsigned seed, int plays, Policy policy)
 {
-    for (int g = 0; g < loops; ++g) {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        unsigned seed = (unsigned)tv.tv_usec;
-        Board board(seed, White, true);
-        for (int i = 0; i < plays; ++i) {
-            bool checkMate; bool draw;
-            board.move(checkMate, draw);
-            if (debug && board.wasPromotion()) {
-                printBoard(board, "promotion");
-            }
-            if (debug && board.wasCastle()) {
-                printBoard(board, "castle");
-            }
-            if (debug && board.wasEnpassant()) {
-                printBoard(board, "enpassant");
-            }
-            if (checkMate) {
-                Turn turn = board.getTurn();
-                if (turn == White) {
-                    printCheckMateBoard(board, Black, White);
-                    ++blackWin[idx];
-                } else {
-                    printCheckMateBoard(board, White, Black);
-                    ++whiteWin[idx];
-                } 
-                break;
-            } else if (draw) {
-                break;
-            }
+    Board board(seed, White, true);
+    for (int i = 0; i < plays; ++i) {
+        bool checkMate; bool draw;
+        board.move(checkMate, draw, policy);
+        if (debug && board.wasPromotion()) {
+            printBoard(board, "promotion");
+        }
+        if (debug && board.wasCastle()) {
+            printBoard(board, "castle");
+        }
+        if (debug && board.wasEnpassant()) {
+            printBoard(board, "enpassant");
+        }
+        if (checkMate) {
+            Turn turn = board.getTurn();
+            if (turn == White) {
+                printCheckMateBoard(board, Black, White);
+                return BlackWin;
+            } else {
+                printCheckMateBoard(board, White, Black);
+                return WhiteWin;
+            } 
+        } else if (draw) {
+            return Draw;
         }
     }
+    return InPlay;
 }
 
-int sumWins(int *wins, int winsLen)
+// a default board has no pieces, so no kings, and has to come out as a
+// draw without touching the king square lookups
+bool emptyBoardDraws()
 {
-    int sum = 0;
-    for (int i = 0; i < winsLen; ++i) {
-        sum += wins[i];
-    }
-    return sum;
+    Board board;
+    bool checkMate; bool draw;
+    board.move(checkMate, draw);
+    Random random(1);
+    Board playout;
+    return !checkMate && draw && (playout.playout(30, random) == Draw) && (board.perft(2) == 0);
 }
 
+enum PolicyType { RandomMoves, CaptureMoves, SafeMoves, GreedyMoves };
+const char *policyNames[] = { "random", "captures", "safe", "greedy" };
+
+// a game for the self play workers, each game number gets its own seed
+struct Game
+{
+    unsigned seed;
+    int plays;
+    PolicyType policy;
+
+    Result operator()(unsigned worker, unsigned idx) const
+    {
+        switch (policy)
+        {
+        case CaptureMoves: return playGame(seed + idx, plays, CapturePolicy());
+        case SafeMoves: return playGame(seed + idx, plays, SafePolicy());
+        case GreedyMoves: return playGame(seed + idx, plays, GreedyPolicy());
+        default: return playGame(seed + idx, plays, RandomPolicy());
+        }
+    }
+};
+
 int main(int argc, char *argv[])
 {
     struct timeval tv_start;
     gettimeofday(&tv_start, NULL);
     int loops = (argc > 2) ? atoi(argv[2]) : 100;
     int plays = (argc > 1) ? atoi(argv[1]) : 30;
-    int numThreads = 4;
+    int numThreads = (argc > 3) ? atoi(argv[3]) : 4;
+    PolicyType policy = RandomMoves;
+    for (int p = 0; (argc > 4) && (p < 4); ++p) {
+        if (strcmp(argv[4], policyNames[p]) == 0) { policy = (PolicyType)p; }
+    }
 
-    std::thread thread1(playGame, 0, loops, plays);
-    std::thread thread2(playGame, 1, loops, plays);
-    std::thread thread3(playGame, 2, loops, plays);
-    std::thread thread4(playGame, 3, loops, plays);
+    if (!emptyBoardDraws()) {
+        printf("a move on an empty board is not a draw\n");
+        return 1;
+    }
 
-    thread1.join();
-    thread2.join();
-    thread3.join();
-    thread4.join();
+    // loops games for each thread, handed out so no thread sits idle
+    SelfPlay selfPlay(numThreads);
+    numThreads = selfPlay.getNumWorkers();
+    Game game = { (unsigned)tv_start.tv_usec, plays, policy };
+    SelfPlayCounts counts = selfPlay.run(loops * numThreads, game);
 
     struct timeval tv_end;
     gettimeofday(&tv_end, NULL);
     unsigned long start = ((unsigned long)tv_start.tv_sec) * 1000 * 1000 + tv_start.tv_usec; 
     unsigned long end = ((unsigned long)tv_end.tv_sec) * 1000 * 1000 + tv_end.tv_usec; 
-    printf("time for %d loops of %d plays is %lu in %d threads\n", loops, plays, end - start, numThreads);
-    int whiteWins = sumWins(whiteWin, numThreads);
-    int blackWins = sumWins(blackWin, numThreads);
-    printf("whiteWin(%d) blackWin(%d) draw(%d)\n", whiteWins, blackWins, (1 * loops - (whiteWins + blackWins)));
+    printf("time for %d loops of %d plays is %lu in %d threads with %s moves\n", loops, plays, end - start,
+           numThreads, policyNames[policy]);
+    printf("whiteWin(%lu) blackWin(%lu) draw(%lu) unfinished(%lu)\n", counts.whiteWins, counts.blackWins,
+           counts.draws, counts.unfinished);
 
     return 0;
 }
@@ -0,0 +1,116 @@
+#include <string.h>
+#include <unistd.h>
+#include "Mcts.hpp"
+#include "Policy.hpp"
+
+// a test position to search, with the move it has to find if there is one
+struct Position
+{
+    const char *name;
+    const char *fen;
+    const char *best;
+};
+
+Position positions[] = {
+    { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0 },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 0 },
+    { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 0 },
+    { "scholar's mate", "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 2 4", "f3->f7" },
+};
+const int numPositions = sizeof(positions) / sizeof(positions[0]);
+
+enum PolicyType { RandomMoves, CaptureMoves, SafeMoves, GreedyMoves, NumPolicies };
+const char *policyNames[NumPolicies] = { "random", "captures", "safe", "greedy" };
+
+void usage(const char *prog)
+{
+    printf("usage: %s [-n nodes] [-i iterations] [-m millis] [-t threads] [-s policy] [-p position]\n"
+           "  -n  size of the node pool, 1048576 by default\n"
+           "  -i  stop after this many playouts, 100000 by default\n"
+           "  -m  stop after this many milliseconds\n"
+           "  -t  number of threads searching the one tree\n"
+           "  -s  playout policy, random, captures, safe or greedy\n"
+           "  -p  only search one position, 0 to %d\n",
+           prog, numPositions - 1);
+}
+
+// search one position and print the root moves, false if it has a best
+// move and the search did not find it
+template <typename Policy>
+bool searchPosition(Mcts& mcts, const Position& pos, unsigned long iterations, unsigned long millis,
+                    unsigned numThreads, Policy policy)
+{
+    Board board;
+    board.fromFEN(pos.fen);
+    printf("%s in %u threads\n", pos.name, numThreads);
+    const auto start = std::chrono::steady_clock::now();
+    mcts.search(board, iterations, millis, numThreads, policy);
+    const unsigned long elapsed = (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    RootMoves moves;
+    mcts.rootMoves(moves);
+    for (unsigned i = 0; i < moves.size(); ++i) {
+        std::string str;
+        moves[i].move.toStringMove(str);
+        printf("  %-6s visits %8u value %.3f\n", str.c_str(), moves[i].visits, moves[i].value);
+    }
+    Move best;
+    std::string bestStr = "none";
+    if (mcts.bestMove(best)) {
+        bestStr.clear();
+        best.toStringMove(bestStr);
+    }
+    printf("  best %s iterations %lu nodes %u time %lu ms %.0f playouts/s\n", bestStr.c_str(),
+           mcts.iterations(), mcts.nodes(), elapsed, elapsed ? mcts.iterations() * 1e3 / elapsed : 0.0);
+    if (pos.best && (bestStr != pos.best)) {
+        printf("  failed, expected %s\n", pos.best);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned maxNodes = 1 << 20;
+    unsigned long iterations = 100000;
+    unsigned long millis = 0;
+    unsigned numThreads = 1;
+    int policy = NumPolicies;
+    const char *policyName = "random";
+    int only = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:i:m:t:s:p:")) != -1) {
+        switch (opt) {
+        case 'n': maxNodes = strtoul(optarg, NULL, 10); break;
+        case 'i': iterations = strtoul(optarg, NULL, 10); break;
+        case 'm': millis = strtoul(optarg, NULL, 10); break;
+        case 't': numThreads = atoi(optarg); break;
+        case 's': policyName = optarg; break;
+        case 'p': only = atoi(optarg); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    for (int p = 0; p < NumPolicies; ++p) {
+        if (strcmp(policyName, policyNames[p]) == 0) { policy = p; }
+    }
+    if ((maxNodes < 1) || (iterations < 1) || (numThreads < 1) || (policy == NumPolicies) ||
+        (only >= numPositions)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Mcts mcts(maxNodes);
+    bool ok = true;
+    for (int p = 0; p < numPositions; ++p) {
+        if ((only >= 0) && (p != only)) { continue; }
+        const Position& pos = positions[p];
+        switch (policy) {
+        case CaptureMoves: ok &= searchPosition(mcts, pos, iterations, millis, numThreads, CapturePolicy()); break;
+        case SafeMoves: ok &= searchPosition(mcts, pos, iterations, millis, numThreads, SafePolicy()); break;
+        case GreedyMoves: ok &= searchPosition(mcts, pos, iterations, millis, numThreads, GreedyPolicy()); break;
+        default: ok &= searchPosition(mcts, pos, iterations, millis, numThreads, RandomPolicy()); break;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <unistd.h>
+#include <sys/time.h>
+#include "Chess.hpp"
+
+// a test position and its known node counts by depth, 0 when not known
+struct Position
+{
+    const char *name;
+    const char *fen;
+    uint64_t nodes[7];
+};
+
+Position positions[] = {
+    { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      { 1, 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      { 1, 48, 2039, 97862, 4085603, 193690690, 8031647685ULL } },
+    { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      { 1, 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "promotions", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      { 1, 6, 264, 9467, 422333, 15833292, 706045033 } },
+    { "talkchess", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      { 1, 44, 1486, 62379, 2103487, 89941194, 0 } },
+};
+const int numPositions = sizeof(positions) / sizeof(positions[0]);
+const int maxDepth = 6;
+
+unsigned long now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((unsigned long)tv.tv_sec) * 1000 * 1000 + tv.tv_usec;
+}
+
+// the root moves are handed out one at a time, each thread walks them on its own board
+void perftMoves(Board board, const Moves& moves, std::vector<uint64_t>& counts,
+                std::atomic<unsigned>& next, int depth, bool bulk)
+{
+    for (unsigned i = next++; i < moves.size(); i = next++) {
+        counts[i] = board.perft(moves[i], depth, bulk);
+    }
+}
+
+uint64_t runPerft(const Position& pos, int depth, int numThreads, bool bulk, bool divide)
+{
+    Board board;
+    board.fromFEN(pos.fen);
+    Moves moves;
+    board.legalMoves(board.getTurn(), moves);
+    std::vector<uint64_t> counts(moves.size(), 0);
+    std::atomic<unsigned> next(0);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < numThreads; ++t) {
+        threads.push_back(std::thread(perftMoves, board, std::cref(moves), std::ref(counts),
+                                      std::ref(next), depth, bulk));
+    }
+    perftMoves(board, moves, counts, next, depth, bulk);
+    for (unsigned t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    uint64_t nodes = 0;
+    for (unsigned i = 0; i < moves.size(); ++i) {
+        if (divide) {
+            std::string moveStr;
+            moves[i].toStringMove(moveStr);
+            printf("  %s %llu\n", moveStr.c_str(), (unsigned long long)counts[i]);
+        }
+        nodes += counts[i];
+    }
+    return nodes;
+}
+
+// play games of random moves from pos with Board::move, after each ply the
+// attack counts play() keeps up to date have to match a count from scratch
+bool checkAttacks(const Position& pos, int games, int plies, unsigned long& checked)
+{
+    for (int g = 0; g < games; ++g) {
+        Board board(g);
+        board.fromFEN(pos.fen);
+        for (int i = 0; i < plies; ++i) {
+            bool checkMate; bool draw;
+            board.move(checkMate, draw);
+            Board recount(board);
+            recount.setAttacks();
+            for (int s = 0; s < 2; ++s) {
+                const Side side = s ? Black : White;
+                std::string counts, expect;
+                board.toStringAttacks(side, counts);
+                recount.toStringAttacks(side, expect);
+                if (counts != expect) {
+                    std::string boardStr, movesStr;
+                    board.toString(boardStr);
+                    board.toStringMoves(movesStr);
+                    printf("%s game %d ply %d attack counts differ:\n%s\nkept:\n%s\nrecount:\n%s\n"
+                           "moves:\n%s\n", pos.name, g, i, boardStr.c_str(), counts.c_str(), expect.c_str(),
+                           movesStr.c_str());
+                    return false;
+                }
+            }
+            ++checked;
+            if (checkMate || draw) { break; }
+        }
+    }
+    return true;
+}
+
+// look up rook, bishop and queen attacks through the magic or PEXT tables
+// for every subset of each square's blocker mask, then for count random
+// boards, and check them against walking the rays
+bool checkSliders(int count)
+{
+    const SliderTables& tables = SliderTables::get();
+    for (int sq = 0; sq < 64; ++sq) {
+        const Magic *magics[2] = { &tables.rook[sq], &tables.bishop[sq] };
+        for (int m = 0; m < 2; ++m) {
+            const Bitboard mask = magics[m]->mask;
+            Bitboard occ = 0;
+            do {
+                const Bitboard slow = m ? slowBishopAttacks(sq, occ) : slowRookAttacks(sq, occ);
+                if ((*magics[m])(occ) != slow) {
+                    printf("%s square %d blockers %016llx differ\n", m ? "bishop" : "rook", sq,
+                           (unsigned long long)occ);
+                    return false;
+                }
+                occ = (occ - mask) & mask;
+            } while (occ);
+        }
+    }
+    Random random(1);
+    for (int i = 0; i < count; ++i) {
+        // from nearly full to nearly empty boards
+        Bitboard occ = ((Bitboard)random.next() << 32) | random.next();
+        for (int sparse = i & 3; sparse; --sparse) {
+            occ &= ((Bitboard)random.next() << 32) | random.next();
+        }
+        for (int sq = 0; sq < 64; ++sq) {
+            const Bitboard rook = slowRookAttacks(sq, occ);
+            const Bitboard bishop = slowBishopAttacks(sq, occ);
+            if ((rookAttacks(sq, occ) != rook) || (bishopAttacks(sq, occ) != bishop) ||
+                (queenAttacks(sq, occ) != (rook | bishop))) {
+                printf("square %d occupied %016llx differ\n", sq, (unsigned long long)occ);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void usage(const char *prog)
+{
+    printf("usage: %s [-a games] [-d] [-m boards] [-s] [-t threads] [-p position] [depth]\n"
+           "  -a  also play games of random moves from each position and check the\n"
+           "      attack counts kept by play() against a recount after every ply\n"
+           "  -d  divide, print the node count below each root move\n"
+           "  -m  also check slider attack lookups on every blocker subset and on\n"
+           "      this many random boards against walking the rays\n"
+           "  -s  slow, play the last ply instead of counting the move list\n"
+           "  -t  number of threads to split the root moves over\n"
+           "  -p  only run one position, 0 to %d\n",
+           prog, numPositions - 1);
+}
+
+int main(int argc, char *argv[])
+{
+    bool divide = false;
+    bool bulk = true;
+    int numThreads = 1;
+    int only = -1;
+    int attackGames = 0;
+    int sliderBoards = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:dm:st:p:")) != -1) {
+        switch (opt) {
+        case 'a': attackGames = atoi(optarg); break;
+        case 'd': divide = true; break;
+        case 'm': sliderBoards = atoi(optarg); break;
+        case 's': bulk = false; break;
+        case 't': numThreads = atoi(optarg); break;
+        case 'p': only = atoi(optarg); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    int depth = (optind < argc) ? atoi(argv[optind]) : 4;
+    if ((depth < 1) || (depth > maxDepth) || (numThreads < 1) || (only >= numPositions) || (attackGames < 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int failed = 0;
+    if (sliderBoards >= 0) {
+        const bool same = checkSliders(sliderBoards);
+#ifdef CHESS_USE_PEXT
+        const char *lookup = "pext";
+#else
+        const char *lookup = "magic";
+#endif
+        printf("%s slider attacks on every blocker subset and %d random boards %s\n", lookup, sliderBoards,
+               same ? "ok" : "FAIL");
+        if (!same) { ++failed; }
+    }
+    uint64_t totalNodes = 0;
+    unsigned long totalTime = 0;
+    for (int p = 0; p < numPositions; ++p) {
+        if ((only >= 0) && (p != only)) { continue; }
+        const Position& pos = positions[p];
+        unsigned long start = now();
+        uint64_t nodes = runPerft(pos, depth, numThreads, bulk, divide);
+        unsigned long usec = now() - start;
+        totalNodes += nodes;
+        totalTime += usec;
+        uint64_t expect = pos.nodes[depth];
+        const char *result = (expect == 0) ? "??" : (nodes == expect) ? "ok" : "FAIL";
+        if (expect && (nodes != expect)) { ++failed; }
+        printf("%-10s depth %d nodes %llu expect %llu %s time %lu us %.0f nodes/s\n",
+               pos.name, depth, (unsigned long long)nodes, (unsigned long long)expect, result,
+               usec, usec ? nodes * 1e6 / usec : 0.0);
+    }
+    printf("total nodes %llu time %lu us %.0f nodes/s in %d threads\n",
+           (unsigned long long)totalNodes, totalTime,
+           totalTime ? totalNodes * 1e6 / totalTime : 0.0, numThreads);
+    if (attackGames) {
+        unsigned long checked = 0;
+        bool same = true;
+        for (int p = 0; same && (p < numPositions); ++p) {
+            if ((only >= 0) && (p != only)) { continue; }
+            same = checkAttacks(positions[p], attackGames, 200, checked);
+        }
+        printf("attack counts after %lu plies %s\n", checked, same ? "ok" : "FAIL");
+        if (!same) { ++failed; }
+    }
+
+    return failed ? 1 : 0;
+}
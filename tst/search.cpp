@@ -0,0 +1,127 @@
+#include <unistd.h>
+#include "Search.hpp"
+
+// a test position to search
+struct Position
+{
+    const char *name;
+    const char *fen;
+};
+
+Position positions[] = {
+    { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1" },
+    { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+    { "middlegame", "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8" },
+    { "mate in 3", "r1b1kb1r/pppp1ppp/5q2/4n3/3KP3/2N3PN/PPP4P/R1BQ1B1R b kq - 0 1" },
+};
+const int numPositions = sizeof(positions) / sizeof(positions[0]);
+
+void printInfo(const SearchInfo& info)
+{
+    char score[32];
+    if (info.score >= Search::MateBound) {
+        snprintf(score, sizeof(score), "mate %d", (Search::MateScore - info.score + 1) / 2);
+    } else if (info.score <= -Search::MateBound) {
+        snprintf(score, sizeof(score), "mate -%d", (Search::MateScore + info.score) / 2);
+    } else {
+        snprintf(score, sizeof(score), "%d", info.score);
+    }
+    std::string pv;
+    for (unsigned i = 0; i < info.pv.size(); ++i) {
+        pv += ' ';
+        info.pv[i].toStringMove(pv);
+    }
+    printf("  depth %2d score %-8s nodes %10llu time %6lu ms %9lu nodes/s pv%s\n",
+           info.depth, score, (unsigned long long)info.nodes, info.millis, info.nodesPerSecond(),
+           pv.c_str());
+}
+
+void usage(const char *prog)
+{
+    printf("usage: %s [-c] [-h megabytes] [-n nodes] [-m millis] [-t threads] [-p position] [depth]\n"
+           "  -c  also search with one thread and print the speedup to reach the same depth\n"
+           "  -h  hash table size in MB, 16 by default\n"
+           "  -n  stop after this many nodes\n"
+           "  -m  stop after this many milliseconds\n"
+           "  -t  number of lazy SMP search threads\n"
+           "  -p  only search one position, 0 to %d\n",
+           prog, numPositions - 1);
+}
+
+// search one position from an empty hash table, printing each iteration
+SearchInfo searchPosition(Search& search, TransTable& table, const Position& pos, int depth,
+                          uint64_t maxNodes, unsigned long maxMillis)
+{
+    Board board;
+    board.fromFEN(pos.fen);
+    table.clear();
+    printf("%s in %u threads\n", pos.name, search.getThreads());
+    search.search(board, depth, maxNodes, maxMillis, printInfo);
+    const SearchInfo& info = search.info();
+    Move best;
+    std::string bestStr = "none";
+    if (search.bestMove(best)) {
+        bestStr.clear();
+        best.toStringMove(bestStr);
+    }
+    printf("  best %s nodes %llu time %lu ms %lu nodes/s\n", bestStr.c_str(),
+           (unsigned long long)info.nodes, info.millis, info.nodesPerSecond());
+    return info;
+}
+
+int main(int argc, char *argv[])
+{
+    bool compare = false;
+    unsigned numThreads = 1;
+    size_t megabytes = 16;
+    uint64_t maxNodes = 0;
+    unsigned long maxMillis = 0;
+    int only = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "ch:n:m:t:p:")) != -1) {
+        switch (opt) {
+        case 'c': compare = true; break;
+        case 'h': megabytes = atoi(optarg); break;
+        case 'n': maxNodes = strtoull(optarg, NULL, 10); break;
+        case 'm': maxMillis = strtoul(optarg, NULL, 10); break;
+        case 't': numThreads = atoi(optarg); break;
+        case 'p': only = atoi(optarg); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    int depth = (optind < argc) ? atoi(argv[optind]) : 8;
+    if ((depth < 1) || (megabytes < 1) || (numThreads < 1) || (only >= numPositions)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    TransTable table(megabytes);
+    Search search(table, numThreads);
+    Search single(table, 1);
+    uint64_t totalNodes = 0;
+    unsigned long totalTime = 0;
+    unsigned long singleTime = 0;
+    uint64_t singleNodes = 0;
+    for (int p = 0; p < numPositions; ++p) {
+        if ((only >= 0) && (p != only)) { continue; }
+        // the time to reach the same depth with one thread and with all of them
+        if (compare) {
+            const SearchInfo info = searchPosition(single, table, positions[p], depth, maxNodes, maxMillis);
+            singleNodes += info.nodes;
+            singleTime += info.millis;
+        }
+        const SearchInfo info = searchPosition(search, table, positions[p], depth, maxNodes, maxMillis);
+        totalNodes += info.nodes;
+        totalTime += info.millis;
+    }
+    printf("total nodes %llu time %lu ms %.0f nodes/s in %u threads\n", (unsigned long long)totalNodes,
+           totalTime, totalTime ? totalNodes * 1e3 / totalTime : 0.0, numThreads);
+    if (compare && totalTime && singleTime && singleNodes) {
+        printf("speedup %.2f time to depth %d, %.2f nodes/s over one thread\n",
+               (double)singleTime / totalTime, depth,
+               ((double)totalNodes / totalTime) / ((double)singleNodes / singleTime));
+    }
+
+    return 0;
+}